@@ -33,7 +33,7 @@ from _pygit2 import Oid, Tree, Diff
 from .errors import check_error
 from .ffi import ffi, C
 from .utils import is_string, to_bytes, to_str
-from .utils import GenericIterator, StrArray
+from .utils import GenericIterator, RepositoryLock, StrArray
 
 
 class Index(object):
@@ -67,11 +67,19 @@ class Index(object):
     def __del__(self):
         C.git_index_free(self._index)
 
+    def _locked(self):
+        """The lock to hold around the calls that use the index, see
+        RepositoryLock."""
+        return RepositoryLock(getattr(self, '_repo', None))
+
     def __len__(self):
-        return C.git_index_entrycount(self._index)
+        with self._locked():
+            return C.git_index_entrycount(self._index)
 
     def __contains__(self, path):
-        err = C.git_index_find(ffi.NULL, self._index, to_bytes(path))
+        # git_index_find sorts the entries in place
+        with self._locked():
+            err = C.git_index_find(ffi.NULL, self._index, to_bytes(path))
         if err == C.GIT_ENOTFOUND:
             return False
 
@@ -79,18 +87,21 @@ class Index(object):
         return True
 
     def __getitem__(self, key):
-        centry = ffi.NULL
-        if is_string(key):
-            centry = C.git_index_get_bypath(self._index, to_bytes(key), 0)
-        elif not key >= 0:
+        if not is_string(key) and not key >= 0:
             raise ValueError(key)
-        else:
-            centry = C.git_index_get_byindex(self._index, key)
 
-        if centry == ffi.NULL:
-            raise KeyError(key)
+        # The entry points into the index, which add() and read() may
+        # replace, so copy it before letting go of the lock
+        with self._locked():
+            if is_string(key):
+                centry = C.git_index_get_bypath(self._index, to_bytes(key), 0)
+            else:
+                centry = C.git_index_get_byindex(self._index, key)
+
+            if centry == ffi.NULL:
+                raise KeyError(key)
 
-        return IndexEntry._from_c(centry)
+            return IndexEntry._from_c(centry)
 
     def __iter__(self):
         return GenericIterator(self)
@@ -106,17 +117,20 @@ class Index(object):
         the file has changed
         """
 
-        err = C.git_index_read(self._index, force)
+        with self._locked():
+            err = C.git_index_read(self._index, force)
         check_error(err, True)
 
     def write(self):
         """Write the contents of the Index to disk
         """
-        err = C.git_index_write(self._index)
+        with self._locked():
+            err = C.git_index_write(self._index)
         check_error(err, True)
 
     def clear(self):
-        err = C.git_index_clear(self._index)
+        with self._locked():
+            err = C.git_index_clear(self._index)
         check_error(err)
 
     def read_tree(self, tree):
@@ -140,7 +154,8 @@ class Index(object):
 
         tree_cptr = ffi.new('git_tree **')
         ffi.buffer(tree_cptr)[:] = tree._pointer[:]
-        err = C.git_index_read_tree(self._index, tree_cptr[0])
+        with self._locked():
+            err = C.git_index_read_tree(self._index, tree_cptr[0])
         check_error(err)
 
     def write_tree(self, repo=None):
@@ -156,10 +171,11 @@ class Index(object):
         It returns the id of the resulting tree.
         """
         coid = ffi.new('git_oid *')
-        if repo:
-            err = C.git_index_write_tree_to(coid, self._index, repo._repo)
-        else:
-            err = C.git_index_write_tree(coid, self._index)
+        with self._locked():
+            if repo:
+                err = C.git_index_write_tree_to(coid, self._index, repo._repo)
+            else:
+                err = C.git_index_write_tree(coid, self._index)
 
         check_error(err)
         return Oid(raw=bytes(ffi.buffer(coid)[:]))
@@ -167,7 +183,8 @@ class Index(object):
     def remove(self, path):
         """Remove an entry from the Index.
         """
-        err = C.git_index_remove(self._index, to_bytes(path), 0)
+        with self._locked():
+            err = C.git_index_remove(self._index, to_bytes(path), 0)
         check_error(err, True)
 
     def add_all(self, pathspecs=[]):
@@ -176,7 +193,7 @@ class Index(object):
         If pathspecs are specified, only files matching those pathspecs will
         be added.
         """
-        with StrArray(pathspecs) as arr:
+        with StrArray(pathspecs) as arr, self._locked():
             err = C.git_index_add_all(self._index, arr, 0, ffi.NULL, ffi.NULL)
             check_error(err, True)
 
@@ -195,11 +212,13 @@ class Index(object):
 
         if is_string(path_or_entry):
             path = path_or_entry
-            err = C.git_index_add_bypath(self._index, to_bytes(path))
+            with self._locked():
+                err = C.git_index_add_bypath(self._index, to_bytes(path))
         elif isinstance(path_or_entry, IndexEntry):
             entry = path_or_entry
             centry, str_ref = entry._to_c()
-            err = C.git_index_add(self._index, centry)
+            with self._locked():
+                err = C.git_index_add(self._index, centry)
         else:
             raise AttributeError('argument must be string or IndexEntry')
 
@@ -235,8 +254,9 @@ class Index(object):
         copts.interhunk_lines = interhunk_lines
 
         cdiff = ffi.new('git_diff **')
-        err = C.git_diff_index_to_workdir(cdiff, self._repo._repo,
-                                          self._index, copts)
+        with self._locked():
+            err = C.git_diff_index_to_workdir(cdiff, self._repo._repo,
+                                              self._index, copts)
         check_error(err)
 
         return Diff.from_c(bytes(ffi.buffer(cdiff)[:]), self._repo)
@@ -280,8 +300,9 @@ class Index(object):
         ffi.buffer(ctree)[:] = tree._pointer[:]
 
         cdiff = ffi.new('git_diff **')
-        err = C.git_diff_tree_to_index(cdiff, self._repo._repo, ctree[0],
-                                       self._index, copts)
+        with self._locked():
+            err = C.git_diff_tree_to_index(cdiff, self._repo._repo, ctree[0],
+                                           self._index, copts)
         check_error(err)
 
         return Diff.from_c(bytes(ffi.buffer(cdiff)[:]), self._repo)
@@ -380,18 +401,21 @@ class ConflictCollection(object):
         cours = ffi.new('git_index_entry **')
         ctheirs = ffi.new('git_index_entry **')
 
-        err = C.git_index_conflict_get(cancestor, cours, ctheirs,
-                                       self._index._index, to_bytes(path))
-        check_error(err)
+        with self._index._locked():
+            err = C.git_index_conflict_get(cancestor, cours, ctheirs,
+                                           self._index._index, to_bytes(path))
+            check_error(err)
 
-        ancestor = IndexEntry._from_c(cancestor[0])
-        ours = IndexEntry._from_c(cours[0])
-        theirs = IndexEntry._from_c(ctheirs[0])
+            ancestor = IndexEntry._from_c(cancestor[0])
+            ours = IndexEntry._from_c(cours[0])
+            theirs = IndexEntry._from_c(ctheirs[0])
 
         return ancestor, ours, theirs
 
     def __delitem__(self, path):
-        err = C.git_index_conflict_remove(self._index._index, to_bytes(path))
+        with self._index._locked():
+            err = C.git_index_conflict_remove(self._index._index,
+                                              to_bytes(path))
         check_error(err)
 
     def __iter__(self):
@@ -418,14 +442,16 @@ class ConflictIterator(object):
         cours = ffi.new('git_index_entry **')
         ctheirs = ffi.new('git_index_entry **')
 
-        err = C.git_index_conflict_next(cancestor, cours, ctheirs, self._iter)
-        if err == C.GIT_ITEROVER:
-            raise StopIteration
+        with self._index._locked():
+            err = C.git_index_conflict_next(cancestor, cours, ctheirs,
+                                            self._iter)
+            if err == C.GIT_ITEROVER:
+                raise StopIteration
 
-        check_error(err)
+            check_error(err)
 
-        ancestor = IndexEntry._from_c(cancestor[0])
-        ours = IndexEntry._from_c(cours[0])
-        theirs = IndexEntry._from_c(ctheirs[0])
+            ancestor = IndexEntry._from_c(cancestor[0])
+            ours = IndexEntry._from_c(cours[0])
+            theirs = IndexEntry._from_c(ctheirs[0])
 
         return ancestor, ours, theirs
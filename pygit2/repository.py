@@ -50,7 +50,7 @@ from .ffi import ffi, C
 from .index import Index
 from .remote import RemoteCollection
 from .blame import Blame
-from .utils import to_bytes, is_string
+from .utils import to_bytes, is_string, RepositoryLock
 from .submodule import Submodule
 
 
@@ -213,7 +213,9 @@ class Repository(_Repository):
         For arguments, see Repository.checkout().
         """
         copts, refs = Repository._checkout_args_to_options(**kwargs)
-        check_error(C.git_checkout_head(self._repo, copts))
+        with RepositoryLock(self):
+            err = C.git_checkout_head(self._repo, copts)
+        check_error(err)
 
     def checkout_index(self, **kwargs):
         """Checkout the repository's index
@@ -221,7 +223,9 @@ class Repository(_Repository):
         For arguments, see Repository.checkout().
         """
         copts, refs = Repository._checkout_args_to_options(**kwargs)
-        check_error(C.git_checkout_index(self._repo, ffi.NULL, copts))
+        with RepositoryLock(self):
+            err = C.git_checkout_index(self._repo, ffi.NULL, copts)
+        check_error(err)
 
     def checkout_tree(self, treeish, **kwargs):
         """Checkout the given treeish
@@ -232,7 +236,9 @@ class Repository(_Repository):
         cptr = ffi.new('git_object **')
         ffi.buffer(cptr)[:] = treeish._pointer[:]
 
-        check_error(C.git_checkout_tree(self._repo, cptr[0], copts))
+        with RepositoryLock(self):
+            err = C.git_checkout_tree(self._repo, cptr[0], copts)
+        check_error(err)
 
     def checkout(self, refname=None, **kwargs):
         """
@@ -765,6 +771,11 @@ class Repository(_Repository):
         if not isinstance(upstream, Oid):
             upstream = self.expand_id(upstream)
 
+        # Answered from the commit-graph file when it has both commits
+        counts = self._ahead_behind_graph(local, upstream)
+        if counts is not None:
+            return counts
+
         ahead, behind = ffi.new('size_t*'), ffi.new('size_t*')
         oid1, oid2 = ffi.new('git_oid *'), ffi.new('git_oid *')
         ffi.buffer(oid1)[:] = local.raw[:]
@@ -83,6 +83,30 @@ class StrArray(object):
         pass
 
 
+class RepositoryLock(object):
+    """Holds the lock of a repository around libgit2 calls
+
+    cffi releases the GIL around every call, so the calls that use the
+    index, the working directory or a walker must take the same lock as the
+    C extension does. The repository may be None, for an Index that is not
+    associated with one.
+
+        with RepositoryLock(repo):
+            err = C.git_index_add_bypath(index, path)
+    """
+
+    def __init__(self, repo):
+        self._repo = repo
+
+    def __enter__(self):
+        if self._repo is not None:
+            self._repo._lock()
+
+    def __exit__(self, type, value, traceback):
+        if self._repo is not None:
+            self._repo._unlock()
+
+
 class GenericIterator(object):
     """Helper to easily implement an iterator.
 
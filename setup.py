@@ -63,6 +63,9 @@ libgit2_bin, libgit2_include, libgit2_lib = get_libgit2_paths()
 pygit2_exts = [os.path.join('src', name) for name in listdir('src')
                if name.endswith('.c')]
 
+# zlib inflates loose objects for Repository.open_reader (see src/odb.c)
+pygit2_libs = ['git2', 'zlib' if os.name == 'nt' else 'z']
+
 
 class TestCommand(Command):
     """Command for running unittests without install."""
@@ -189,7 +192,7 @@ setup(name='pygit2',
       install_requires=['cffi'],
       zip_safe=False,
       ext_modules=[
-          Extension('_pygit2', pygit2_exts, libraries=['git2'],
+          Extension('_pygit2', pygit2_exts, libraries=pygit2_libs,
                     include_dirs=[libgit2_include],
                     library_dirs=[libgit2_lib]),
           # FFI is added in the build step
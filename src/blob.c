@@ -31,6 +31,7 @@
 #include "diff.h"
 #include "error.h"
 #include "object.h"
+#include "odb.h"
 #include "patch.h"
 #include "utils.h"
 
@@ -69,9 +70,11 @@ Blob_diff(Blob *self, PyObject *args, PyObject *kwds)
                                      &old_as_path, &new_as_path))
         return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_patch_from_blobs(&patch, self->blob, old_as_path,
                                py_blob ? py_blob->blob : NULL, new_as_path,
                                &opts);
+    Py_END_ALLOW_THREADS
     if (err < 0)
         return Error_set(err);
 
@@ -112,18 +115,39 @@ Blob_diff_to_buffer(Blob *self, PyObject *args, PyObject *kwds)
                                      &old_as_path, &buffer_as_path))
         return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_patch_from_blob_and_buffer(&patch, self->blob, old_as_path,
                                          buffer, buffer_len, buffer_as_path,
                                          &opts);
+    Py_END_ALLOW_THREADS
     if (err < 0)
         return Error_set(err);
 
     return wrap_patch(patch);
 }
 
+PyDoc_STRVAR(Blob_open_reader__doc__,
+  "open_reader([chunk_size]) -> OdbReader\n"
+  "\n"
+  "Open the blob contents for reading, as a file-like object. Iterating\n"
+  "over the reader yields the data in chunks of chunk_size bytes (64 KiB\n"
+  "by default).");
+
+PyObject *
+Blob_open_reader(Blob *self, PyObject *args)
+{
+    Py_ssize_t chunk_size = ODB_READER_CHUNK_SIZE;
+
+    if (!PyArg_ParseTuple(args, "|n", &chunk_size))
+        return NULL;
+
+    return wrap_odb_reader_from_buffer((PyObject *)self, chunk_size);
+}
+
 static PyMethodDef Blob_methods[] = {
     METHOD(Blob, diff, METH_VARARGS | METH_KEYWORDS),
     METHOD(Blob, diff_to_buffer, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Blob, open_reader, METH_VARARGS),
     {NULL}
 };
 
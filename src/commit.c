@@ -33,8 +33,7 @@
 #include "commit.h"
 #include "object.h"
 #include "oid.h"
-
-extern PyTypeObject TreeType;
+#include "objectcache.h"
 
 
 PyDoc_STRVAR(Commit_message_encoding__doc__, "Message encoding.");
@@ -127,9 +126,14 @@ PyObject *
 Commit_tree__get__(Commit *commit)
 {
     git_tree *tree;
-    Tree *py_tree;
+    PyObject *py_tree;
     int err;
 
+    py_tree = ObjectCache_get(&commit->repo->cache,
+                              git_commit_tree_id(commit->commit));
+    if (py_tree != NULL)
+        return py_tree;
+
     err = git_commit_tree(&tree, commit->commit);
     if (err == GIT_ENOTFOUND)
         Py_RETURN_NONE;
@@ -137,13 +141,7 @@ Commit_tree__get__(Commit *commit)
     if (err < 0)
         return Error_set(err);
 
-    py_tree = PyObject_New(Tree, &TreeType);
-    if (py_tree) {
-        Py_INCREF(commit->repo);
-        py_tree->repo = commit->repo;
-        py_tree->tree = (git_tree*)tree;
-    }
-    return (PyObject*)py_tree;
+    return wrap_new_object((git_object*)tree, commit->repo);
 }
 
 PyDoc_STRVAR(Commit_tree_id__doc__, "The id of the tree attached to the commit.");
@@ -162,8 +160,6 @@ Commit_parents__get__(Commit *self)
     Repository *py_repo;
     unsigned int i, parent_count;
     const git_oid *parent_oid;
-    git_commit *parent;
-    int err;
     PyObject *py_parent;
     PyObject *list;
 
@@ -181,13 +177,7 @@ Commit_parents__get__(Commit *self)
             return NULL;
         }
 
-        err = git_commit_lookup(&parent, py_repo->repo, parent_oid);
-        if (err < 0) {
-            Py_DECREF(list);
-            return Error_set_oid(err, parent_oid, GIT_OID_HEXSZ);
-        }
-
-        py_parent = wrap_object((git_object*)parent, py_repo);
+        py_parent = lookup_object(py_repo, parent_oid, GIT_OBJ_COMMIT);
         if (py_parent == NULL) {
             Py_DECREF(list);
             return NULL;
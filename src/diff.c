@@ -31,7 +31,9 @@
 #include "diff.h"
 #include "error.h"
 #include "oid.h"
+#include "parallel.h"
 #include "patch.h"
+#include "worddiff.h"
 #include "types.h"
 #include "utils.h"
 
@@ -40,6 +42,7 @@ extern PyObject *GitError;
 extern PyTypeObject TreeType;
 extern PyTypeObject IndexType;
 extern PyTypeObject DiffType;
+extern PyTypeObject DiffPatchIterType;
 extern PyTypeObject DiffDeltaType;
 extern PyTypeObject DiffFileType;
 extern PyTypeObject DiffHunkType;
@@ -104,41 +107,28 @@ wrap_diff_delta(const git_diff_delta *delta)
 }
 
 PyObject *
-wrap_diff_hunk(git_patch *patch, size_t idx)
+wrap_diff_hunk(Patch *patch, size_t idx)
 {
     DiffHunk *py_hunk;
     const git_diff_hunk *hunk;
-    const git_diff_line *line;
-    size_t j, lines_in_hunk;
+    size_t lines_in_hunk;
     int err;
 
-    err = git_patch_get_hunk(&hunk, &lines_in_hunk, patch, idx);
+    err = git_patch_get_hunk(&hunk, &lines_in_hunk, patch->patch, idx);
     if (err < 0)
         return Error_set(err);
 
     py_hunk = PyObject_New(DiffHunk, &DiffHunkType);
     if (py_hunk) {
+        Py_INCREF(patch);
+        py_hunk->patch = patch;
+        py_hunk->idx = idx;
         py_hunk->old_start = hunk->old_start;
         py_hunk->old_lines = hunk->old_lines;
         py_hunk->new_start = hunk->new_start;
         py_hunk->new_lines = hunk->new_lines;
         py_hunk->header = to_unicode_n((const char *) &hunk->header,
                 hunk->header_len, NULL, NULL);
-
-        py_hunk->lines = PyList_New(lines_in_hunk);
-        for (j = 0; j < lines_in_hunk; ++j) {
-            PyObject *py_line = NULL;
-
-            err = git_patch_get_line_in_hunk(&line, patch, idx, j);
-            if (err < 0)
-                return Error_set(err);
-
-            py_line = wrap_diff_line(line);
-            if (py_line == NULL)
-                return NULL;
-
-            PyList_SetItem(py_hunk->lines, j, py_line);
-        }
     }
 
     return (PyObject *) py_hunk;
@@ -519,21 +509,693 @@ cleanup:
 }
 
 
+/*
+ * Streaming the patch text.  The patches of the deltas are printed one at
+ * a time, with the GIL released, until there is enough for a chunk.  The
+ * chunks are cut on line boundaries, so each can be decoded on its own.
+ */
+
+static int
+DiffPatchIter_print_cb(const git_diff_delta *delta, const git_diff_hunk *hunk,
+                       const git_diff_line *line, void *payload)
+{
+    DiffPatchIter *self = (DiffPatchIter *)payload;
+    size_t len, alloc;
+    char *ptr;
+
+    len = line->content_len + 1;
+    if (self->size + len > self->alloc) {
+        alloc = self->alloc ? self->alloc : 4096;
+        while (alloc < self->size + len)
+            alloc *= 2;
+
+        ptr = realloc(self->data, alloc);
+        if (ptr == NULL) {
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+        self->data = ptr;
+        self->alloc = alloc;
+    }
+
+    /* Like git_patch_to_buf() */
+    if (line->origin == GIT_DIFF_LINE_CONTEXT ||
+        line->origin == GIT_DIFF_LINE_ADDITION ||
+        line->origin == GIT_DIFF_LINE_DELETION)
+        self->data[self->size++] = line->origin;
+
+    memcpy(self->data + self->size, line->content, line->content_len);
+    self->size += line->content_len;
+    return 0;
+}
+
+/* Prints deltas until a chunk is ready.  Does not need the GIL.  Only
+ * called with less than a chunk left, so the compaction is cheap. */
+static int
+DiffPatchIter_fill(DiffPatchIter *self)
+{
+    git_patch *patch;
+    int err;
+
+    if (self->pos > 0) {
+        memmove(self->data, self->data + self->pos, self->size - self->pos);
+        self->size -= self->pos;
+        self->pos = 0;
+    }
+
+    while (self->size < self->chunk_size && self->i < self->n) {
+        err = git_patch_from_diff(&patch, self->diff->diff, self->i++);
+        if (err < 0)
+            return err;
+        if (patch == NULL)
+            continue;
+
+        err = git_patch_print(patch, DiffPatchIter_print_cb, self);
+        git_patch_free(patch);
+        if (err < 0)
+            return err;
+    }
+
+    return 0;
+}
+
+/* Returns the length of the next chunk, 0 at the end */
+static size_t
+DiffPatchIter_cut(DiffPatchIter *self)
+{
+    const char *start = self->data + self->pos, *end;
+    size_t avail = self->size - self->pos;
+
+    if (avail <= self->chunk_size)
+        return avail;
+
+    /* After the last line that fits, or else after the first line */
+    for (end = start + self->chunk_size; end > start; end--) {
+        if (end[-1] == '\n')
+            return end - start;
+    }
+
+    end = memchr(start + self->chunk_size, '\n', avail - self->chunk_size);
+    return (end == NULL) ? avail : (size_t)(end + 1 - start);
+}
+
+PyObject *
+DiffPatchIter_iternext(DiffPatchIter *self)
+{
+    Repository *py_repo = self->diff->repo;
+    PyObject *py_chunk = NULL;
+    size_t len;
+    int err;
+
+    /* The buffer is shared by every caller of this iterator */
+    if (self->busy) {
+        PyErr_SetString(PyExc_ValueError, "patch iterator already executing");
+        return NULL;
+    }
+    self->busy = 1;
+
+    /* Cut whatever is buffered first: a large file is printed whole */
+    if (self->size - self->pos < self->chunk_size && self->i < self->n) {
+        REPOSITORY_BEGIN_ALLOW_THREADS(py_repo)
+        err = DiffPatchIter_fill(self);
+        REPOSITORY_END_ALLOW_THREADS(py_repo)
+        if (err < 0) {
+            Error_set(err);
+            goto out;
+        }
+    }
+
+    len = DiffPatchIter_cut(self);
+    if (len == 0)
+        goto out;
+
+    if (self->as_bytes)
+        py_chunk = PyBytes_FromStringAndSize(self->data + self->pos, len);
+    else
+        py_chunk = to_unicode_n(self->data + self->pos, len, NULL, NULL);
+    if (py_chunk != NULL)
+        self->pos += len;
+
+out:
+    self->busy = 0;
+    return py_chunk;
+}
+
+void
+DiffPatchIter_dealloc(DiffPatchIter *self)
+{
+    Py_CLEAR(self->diff);
+    free(self->data);
+    PyObject_Del(self);
+}
+
+static PyObject *
+wrap_diff_patch_iter(Diff *diff, Py_ssize_t chunk_size, int as_bytes)
+{
+    DiffPatchIter *iter;
+
+    if (chunk_size < 1) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be >= 1");
+        return NULL;
+    }
+
+    iter = PyObject_New(DiffPatchIter, &DiffPatchIterType);
+    if (iter) {
+        Py_INCREF(diff);
+        iter->diff = diff;
+        iter->i = 0;
+        iter->n = git_diff_num_deltas(diff->diff);
+        iter->data = NULL;
+        iter->size = 0;
+        iter->alloc = 0;
+        iter->pos = 0;
+        iter->chunk_size = chunk_size;
+        iter->as_bytes = as_bytes;
+        iter->busy = 0;
+    }
+
+    return (PyObject*)iter;
+}
+
+
+PyDoc_STRVAR(DiffPatchIter__doc__, "Patch text iterator, see Diff.iter_patch_chunks().");
+
+PyTypeObject DiffPatchIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.DiffPatchIter",                   /* tp_name           */
+    sizeof(DiffPatchIter),                     /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)DiffPatchIter_dealloc,         /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    DiffPatchIter__doc__,                      /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    PyObject_SelfIter,                         /* tp_iter           */
+    (iternextfunc) DiffPatchIter_iternext,     /* tp_iternext       */
+};
+
+PyDoc_STRVAR(Diff_iter_patch_chunks__doc__,
+  "iter_patch_chunks([chunk_size, as_bytes]) -> iterator\n"
+  "\n"
+  "Iterate over the text of the patch (see Diff.patch) in chunks of about\n"
+  "chunk_size bytes (64 KiB by default).  The patch is printed one file at\n"
+  "a time, so memory use is bounded by the largest file's patch rather than\n"
+  "by chunk_size.  Chunks end on line boundaries, and are bytes if as_bytes\n"
+  "is true, strings otherwise.");
+
+PyObject *
+Diff_iter_patch_chunks(Diff *self, PyObject *args, PyObject *kwds)
+{
+    char *keywords[] = {"chunk_size", "as_bytes", NULL};
+    Py_ssize_t chunk_size = 65536;
+    PyObject *py_as_bytes = NULL;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|nO", keywords,
+                                     &chunk_size, &py_as_bytes))
+        return NULL;
+
+    return wrap_diff_patch_iter(self, chunk_size,
+                                py_as_bytes && PyObject_IsTrue(py_as_bytes));
+}
+
+PyDoc_STRVAR(Diff_write_patch__doc__,
+  "write_patch(file[, chunk_size, as_bytes])\n"
+  "\n"
+  "Write the text of the patch to the file, with one file.write() call per\n"
+  "chunk of iter_patch_chunks().  Pass as_bytes=True for a file opened in\n"
+  "binary mode, which also saves decoding the text.");
+
+PyObject *
+Diff_write_patch(Diff *self, PyObject *args, PyObject *kwds)
+{
+    char *keywords[] = {"file", "chunk_size", "as_bytes", NULL};
+    Py_ssize_t chunk_size = 65536;
+    PyObject *py_file, *py_as_bytes = NULL, *iter, *chunk, *result;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|nO", keywords, &py_file,
+                                     &chunk_size, &py_as_bytes))
+        return NULL;
+
+    iter = wrap_diff_patch_iter(self, chunk_size,
+                                py_as_bytes && PyObject_IsTrue(py_as_bytes));
+    if (iter == NULL)
+        return NULL;
+
+    while ((chunk = PyIter_Next(iter)) != NULL) {
+        result = PyObject_CallMethod(py_file, "write", "O", chunk);
+        Py_DECREF(chunk);
+        if (result == NULL)
+            break;
+        Py_DECREF(result);
+    }
+    Py_DECREF(iter);
+
+    if (PyErr_Occurred())
+        return NULL;
+
+    Py_RETURN_NONE;
+}
+
+
+typedef struct {
+    size_t additions;
+    size_t deletions;
+} NumStat;
+
+typedef struct {
+    git_diff *diff;
+    NumStat *stats;
+    size_t i;            /* Of the delta being diffed */
+} NumStatJob;
+
+/* The deltas come in order, but the unmodified ones are skipped */
+static int
+Diff_numstat_file_cb(const git_diff_delta *delta, float progress,
+                     void *payload)
+{
+    NumStatJob *job = (NumStatJob *)payload;
+
+    while (git_diff_get_delta(job->diff, job->i) != delta)
+        job->i++;
+    return 0;
+}
+
+static int
+Diff_numstat_line_cb(const git_diff_delta *delta, const git_diff_hunk *hunk,
+                     const git_diff_line *line, void *payload)
+{
+    NumStatJob *job = (NumStatJob *)payload;
+
+    if (line->origin == GIT_DIFF_LINE_ADDITION)
+        job->stats[job->i].additions++;
+    else if (line->origin == GIT_DIFF_LINE_DELETION)
+        job->stats[job->i].deletions++;
+    return 0;
+}
+
+PyDoc_STRVAR(Diff_numstat__doc__,
+  "numstat() -> [(path, additions, deletions, binary), ...]\n"
+  "\n"
+  "Return the number of added and deleted lines of every delta, like\n"
+  "'git diff --numstat'.  The counts are 0 for binary files.  The lines\n"
+  "are counted as the deltas are diffed, with the GIL released, and no\n"
+  "patches are kept.");
+
+PyObject *
+Diff_numstat(Diff *self)
+{
+    const git_diff_delta *delta;
+    NumStatJob job;
+    PyObject *list = NULL, *tuple;
+    size_t i, n;
+    int err;
+
+    n = git_diff_num_deltas(self->diff);
+    job.diff = self->diff;
+    job.i = 0;
+    job.stats = calloc(n ? n : 1, sizeof(NumStat));
+    if (job.stats == NULL)
+        return PyErr_NoMemory();
+
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    err = git_diff_foreach(self->diff, Diff_numstat_file_cb, NULL,
+                           Diff_numstat_line_cb, &job);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    /* Diffing flags the binary deltas of the diff itself */
+    for (i = 0; i < n; i++) {
+        delta = git_diff_get_delta(self->diff, i);
+        tuple = Py_BuildValue("(NnnN)", to_path(delta->new_file.path),
+                              (Py_ssize_t)job.stats[i].additions,
+                              (Py_ssize_t)job.stats[i].deletions,
+                              PyBool_FromLong(
+                                  (delta->flags & GIT_DIFF_FLAG_BINARY) != 0));
+        if (tuple == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+exit:
+    free(job.stats);
+    return list;
+}
+
+
+typedef struct {
+    git_diff *diff;
+    git_patch **patches;
+    char *done;          /* Diffed before the threads started */
+} PatchesJob;
+
+static int
+Diff_patches_task(size_t i, void *payload)
+{
+    PatchesJob *job = (PatchesJob *)payload;
+
+    if (job->done[i])
+        return 0;
+    return git_patch_from_diff(&job->patches[i], job->diff, i);
+}
+
+/* libgit2 loads the drivers named by the "diff" attribute on first use,
+ * into a registry of the repository that is not safe to fill from several
+ * threads.  So diff the first delta of every named driver up front; the
+ * threads then only ever find the drivers already loaded. */
+static int
+Diff_patches_load_drivers(PatchesJob *job, git_repository *repo, size_t n)
+{
+    const git_diff_delta *delta;
+    const char *path, *value;
+    char **names = NULL, **tmp;
+    size_t i, j, n_names = 0;
+    int side, err = 0;
+
+    for (i = 0; i < n && err == 0; i++) {
+        delta = git_diff_get_delta(job->diff, i);
+        for (side = 0; side < 2 && !job->done[i]; side++) {
+            path = side ? delta->new_file.path : delta->old_file.path;
+            if (side && strcmp(path, delta->old_file.path) == 0)
+                break;
+
+            err = git_attr_get(&value, repo, 0, path, "diff");
+            if (err < 0)
+                break;
+            if (git_attr_value(value) != GIT_ATTR_VALUE_T)
+                continue;
+
+            for (j = 0; j < n_names; j++) {
+                if (strcmp(names[j], value) == 0)
+                    break;
+            }
+            if (j < n_names)
+                continue;
+
+            tmp = realloc(names, (n_names + 1) * sizeof(char *));
+            if (tmp == NULL || (tmp[n_names] = strdup(value)) == NULL) {
+                if (tmp != NULL)
+                    names = tmp;
+                err = GIT_ERROR;
+                giterr_set_oom();
+                break;
+            }
+            names = tmp;
+            n_names++;
+
+            err = git_patch_from_diff(&job->patches[i], job->diff, i);
+            if (err < 0)
+                break;
+            job->done[i] = 1;
+        }
+    }
+
+    for (j = 0; j < n_names; j++)
+        free(names[j]);
+    free(names);
+    return err;
+}
+
+PyDoc_STRVAR(Diff_patches__doc__,
+  "patches([threads]) -> [Patch, ...]\n"
+  "\n"
+  "Return the patches of all the deltas, in order, like list(diff).  The\n"
+  "file contents are diffed with the GIL released, on threads threads at\n"
+  "once (the number of CPUs if 0, the default).");
+
+PyObject *
+Diff_patches(Diff *self, PyObject *args, PyObject *kwds)
+{
+    char *keywords[] = {"threads", NULL};
+    SavedError error = {0, 0, NULL};
+    PatchesJob job;
+    PyObject *list = NULL, *py_patch;
+    size_t i, n;
+    int threads = 0, err = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|i", keywords, &threads))
+        return NULL;
+
+    if (threads <= 0)
+        threads = parallel_cpu_count();
+
+    n = git_diff_num_deltas(self->diff);
+    job.diff = self->diff;
+    job.patches = calloc(n ? n : 1, sizeof(git_patch *));
+    job.done = calloc(n ? n : 1, sizeof(char));
+    if (job.patches == NULL || job.done == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    /* The threads run within this one hold of the lock */
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    if (threads > 1)
+        err = Diff_patches_load_drivers(&job, self->repo->repo, n);
+    if (err == 0)
+        err = parallel_for(n, threads, Diff_patches_task, &job, &error);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    if (err < 0) {
+        if (error.err < 0)
+            Error_set_saved(&error);
+        else
+            Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n; i++) {
+        py_patch = wrap_patch(job.patches[i]);
+        job.patches[i] = NULL;
+        if (py_patch == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, py_patch);
+    }
+
+exit:
+    if (job.patches != NULL) {
+        for (i = 0; i < n; i++)
+            git_patch_free(job.patches[i]);
+    }
+    free(job.patches);
+    free(job.done);
+    return list;
+}
+
+
 static void
 DiffHunk_dealloc(DiffHunk *self)
 {
     Py_CLEAR(self->header);
-    Py_CLEAR(self->lines);
+    Py_CLEAR(self->patch);
     PyObject_Del(self);
 }
 
+PyDoc_STRVAR(DiffHunk_lines__doc__,
+  "Lines, a sequence of DiffLine objects made as they are accessed.");
+
+PyObject *
+DiffHunk_lines__get__(DiffHunk *self)
+{
+    return wrap_patch_lines(self->patch, self->idx);
+}
+
+typedef struct {
+    size_t old_idx;
+    size_t new_idx;
+    WordSpan *old_spans;
+    WordSpan *new_spans;
+    size_t n_old;
+    size_t n_new;
+} WordDiffPair;
+
+static PyObject *
+word_spans_to_list(const WordSpan *spans, size_t n)
+{
+    PyObject *list, *span;
+    size_t i;
+
+    list = PyList_New(n);
+    if (list == NULL)
+        return NULL;
+
+    for (i = 0; i < n; i++) {
+        span = Py_BuildValue("(nn)", (Py_ssize_t)spans[i].start,
+                             (Py_ssize_t)spans[i].end);
+        if (span == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, span);
+    }
+
+    return list;
+}
+
+PyDoc_STRVAR(DiffHunk_word_diff__doc__,
+  "word_diff() -> [(old_index, new_index, old_spans, new_spans), ...]\n"
+  "\n"
+  "Return the intra-line changes of the hunk.  The n-th line of a run of\n"
+  "deleted lines is paired with the n-th line of the run of added lines\n"
+  "that follows it, and each pair is diffed word by word.  The indexes\n"
+  "refer to the lines sequence, and the spans are lists of (start, end)\n"
+  "byte offsets into the content of each line.  Lines with too many\n"
+  "changes are reported as changed throughout.  The lines are diffed\n"
+  "with the GIL released, and no DiffLine objects are made.");
+
+PyObject *
+DiffHunk_word_diff(DiffHunk *self)
+{
+    git_patch *patch = self->patch->patch;
+    const git_diff_line *line, *old_line, *new_line;
+    WordDiffPair *pairs, *pair;
+    PyObject *list = NULL, *old_list, *new_list, *tuple;
+    size_t i, j, n, n_pairs = 0, del_start, del_end, add_start, add_end;
+    int n_lines, err = 0;
+
+    n_lines = git_patch_num_lines_in_hunk(patch, self->idx);
+    if (n_lines < 0)
+        return Error_set(n_lines);
+    n = (size_t)n_lines;
+
+    /* Every pair takes two lines */
+    pairs = calloc(n / 2 + 1, sizeof(WordDiffPair));
+    if (pairs == NULL)
+        return PyErr_NoMemory();
+
+    Py_BEGIN_ALLOW_THREADS
+    i = 0;
+    while (i < n && err == 0) {
+        err = git_patch_get_line_in_hunk(&line, patch, self->idx, i);
+        if (err < 0)
+            break;
+        if (line->origin != GIT_DIFF_LINE_DELETION) {
+            i++;
+            continue;
+        }
+
+        del_start = i;
+        while (i < n && err == 0) {
+            err = git_patch_get_line_in_hunk(&line, patch, self->idx, i);
+            if (err < 0 || line->origin != GIT_DIFF_LINE_DELETION)
+                break;
+            i++;
+        }
+        del_end = i;
+
+        /* The "no newline at end of file" marker of the old side */
+        if (err == 0 && i < n && line->origin == GIT_DIFF_LINE_DEL_EOFNL)
+            i++;
+
+        add_start = i;
+        while (i < n && err == 0) {
+            err = git_patch_get_line_in_hunk(&line, patch, self->idx, i);
+            if (err < 0 || line->origin != GIT_DIFF_LINE_ADDITION)
+                break;
+            i++;
+        }
+        add_end = i;
+
+        for (j = 0; err == 0 && j < del_end - del_start &&
+                    j < add_end - add_start; j++) {
+            pair = &pairs[n_pairs++];
+            pair->old_idx = del_start + j;
+            pair->new_idx = add_start + j;
+            err = git_patch_get_line_in_hunk(&old_line, patch, self->idx,
+                                             pair->old_idx);
+            if (err == 0)
+                err = git_patch_get_line_in_hunk(&new_line, patch, self->idx,
+                                                 pair->new_idx);
+            if (err == 0)
+                err = word_diff(&pair->old_spans, &pair->n_old,
+                                &pair->new_spans, &pair->n_new,
+                                old_line->content, old_line->content_len,
+                                new_line->content, new_line->content_len);
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(n_pairs);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n_pairs; i++) {
+        pair = &pairs[i];
+        old_list = word_spans_to_list(pair->old_spans, pair->n_old);
+        new_list = word_spans_to_list(pair->new_spans, pair->n_new);
+        if (old_list == NULL || new_list == NULL) {
+            Py_XDECREF(old_list);
+            Py_XDECREF(new_list);
+            Py_CLEAR(list);
+            goto exit;
+        }
+        tuple = Py_BuildValue("(nnNN)", (Py_ssize_t)pair->old_idx,
+                              (Py_ssize_t)pair->new_idx, old_list, new_list);
+        if (tuple == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+exit:
+    for (i = 0; i < n_pairs; i++) {
+        free(pairs[i].old_spans);
+        free(pairs[i].new_spans);
+    }
+    free(pairs);
+    return list;
+}
+
+PyMethodDef DiffHunk_methods[] = {
+    METHOD(DiffHunk, word_diff, METH_NOARGS),
+    {NULL}
+};
+
+PyGetSetDef DiffHunk_getseters[] = {
+    GETTER(DiffHunk, lines),
+    {NULL}
+};
+
 PyMemberDef DiffHunk_members[] = {
     MEMBER(DiffHunk, old_start, T_INT, "Old start."),
     MEMBER(DiffHunk, old_lines, T_INT, "Old lines."),
     MEMBER(DiffHunk, new_start, T_INT, "New start."),
     MEMBER(DiffHunk, new_lines, T_INT, "New lines."),
     MEMBER(DiffHunk, header, T_OBJECT, "Header."),
-    MEMBER(DiffHunk, lines, T_OBJECT, "Lines."),
     {NULL}
 };
 
@@ -568,9 +1230,9 @@ PyTypeObject DiffHunkType = {
     0,                                         /* tp_weaklistoffset */
     0,                                         /* tp_iter           */
     0,                                         /* tp_iternext       */
-    0,                                         /* tp_methods        */
+    DiffHunk_methods,                          /* tp_methods        */
     DiffHunk_members,                          /* tp_members        */
-    0,                                         /* tp_getset         */
+    DiffHunk_getseters,                        /* tp_getset         */
     0,                                         /* tp_base           */
     0,                                         /* tp_dict           */
     0,                                         /* tp_descr_get      */
@@ -763,20 +1425,51 @@ Diff_merge(Diff *self, PyObject *args)
 PyDoc_STRVAR(Diff_find_similar__doc__,
   "find_similar([flags, rename_threshold, copy_threshold, rename_from_rewrite_threshold, break_rewrite_threshold, rename_limit])\n"
   "\n"
-  "Find renamed files in diff and updates them in-place in the diff itself.");
+  "Find renamed files in diff and updates them in-place in the diff itself.\n"
+  "\n"
+  "Arguments:\n"
+  "\n"
+  "flags: GIT_DIFF_FIND_* constants, GIT_DIFF_FIND_BY_CONFIG by default.\n"
+  "   GIT_DIFF_FIND_IGNORE_WHITESPACE, GIT_DIFF_FIND_DONT_IGNORE_WHITESPACE\n"
+  "   and GIT_DIFF_FIND_IGNORE_LEADING_WHITESPACE pick the similarity\n"
+  "   metric.\n"
+  "\n"
+  "rename_threshold, copy_threshold: the similarity (0-100) for a file\n"
+  "   to be a rename or a copy of another (50 by default).\n"
+  "\n"
+  "rename_from_rewrite_threshold: the similarity below which a modified\n"
+  "   file may be the target of a rename (50 by default).\n"
+  "\n"
+  "break_rewrite_threshold: the similarity below which a modified file is\n"
+  "   split into a deletion and an addition (60 by default).\n"
+  "\n"
+  "rename_limit: the maximum number of files compared with each source,\n"
+  "   the diff.renameLimit configuration (or 200) by default.  This bounds\n"
+  "   the cost of the detection, which is quadratic.\n"
+  "\n"
+  "With GIT_DIFF_FIND_EXACT_MATCH_ONLY files are only compared by their\n"
+  "ids, so only exact renames and copies are found, but no content is\n"
+  "ever loaded.");
 
 PyObject *
 Diff_find_similar(Diff *self, PyObject *args, PyObject *kwds)
 {
     int err;
     git_diff_find_options opts = GIT_DIFF_FIND_OPTIONS_INIT;
+    Py_ssize_t rename_limit = 0;
 
     char *keywords[] = {"flags", "rename_threshold", "copy_threshold", "rename_from_rewrite_threshold", "break_rewrite_threshold", "rename_limit", NULL};
 
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iHHHHI", keywords,
-                &opts.flags, &opts.rename_threshold, &opts.copy_threshold, &opts.rename_from_rewrite_threshold, &opts.break_rewrite_threshold, &opts.rename_limit))
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|IHHHHn", keywords,
+                &opts.flags, &opts.rename_threshold, &opts.copy_threshold, &opts.rename_from_rewrite_threshold, &opts.break_rewrite_threshold, &rename_limit))
         return NULL;
 
+    if (rename_limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "rename_limit must be >= 0");
+        return NULL;
+    }
+    opts.rename_limit = rename_limit;
+
     err = git_diff_find_similar(self->diff, &opts);
     if (err < 0)
         return Error_set(err);
@@ -843,6 +1536,10 @@ static PyMethodDef Diff_methods[] = {
     METHOD(Diff, merge, METH_VARARGS),
     METHOD(Diff, find_similar, METH_VARARGS | METH_KEYWORDS),
     METHOD(Diff, from_c, METH_STATIC | METH_VARARGS),
+    METHOD(Diff, iter_patch_chunks, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Diff, numstat, METH_NOARGS),
+    METHOD(Diff, patches, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Diff, write_patch, METH_VARARGS | METH_KEYWORDS),
     {NULL}
 };
 
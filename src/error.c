@@ -126,3 +126,27 @@ Error_set_oid(int err, const git_oid *oid, size_t len)
     hex[len] = '\0';
     return Error_set_str(err, hex);
 }
+
+void
+Error_save(SavedError *saved, int err)
+{
+    const git_error* error = giterr_last();
+
+    saved->err = err;
+    saved->klass = (error == NULL) ? GITERR_NONE : error->klass;
+    saved->message = (error == NULL) ? NULL : strdup(error->message);
+}
+
+PyObject *
+Error_set_saved(SavedError *saved)
+{
+    if (saved->message == NULL) {
+        giterr_clear();
+    } else {
+        giterr_set_str(saved->klass, saved->message);
+        free(saved->message);
+        saved->message = NULL;
+    }
+
+    return Error_set(saved->err);
+}
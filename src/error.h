@@ -38,4 +38,15 @@ PyObject* Error_set_exc(PyObject* exception);
 PyObject* Error_set_str(int err, const char *str);
 PyObject* Error_set_oid(int err, const git_oid *oid, size_t len);
 
+/* libgit2 keeps the last error per thread, so an error raised in a worker
+ * thread is saved there and re-raised from the thread holding the GIL. */
+typedef struct {
+    int err;
+    int klass;
+    char *message;
+} SavedError;
+
+void Error_save(SavedError *saved, int err);
+PyObject* Error_set_saved(SavedError *saved);
+
 #endif
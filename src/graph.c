@@ -0,0 +1,1060 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The commit-graph sidecar file.  It caches, for every commit reachable from
+ * the references, what ancestry queries need: the parents, the commit time
+ * and the generation number.  Queries then run on plain arrays instead of
+ * parsing commits from the object database.
+ *
+ * The file is the header below followed by these arrays, in the byte order
+ * of the machine that wrote it:
+ *
+ *   int64_t  time[n_commits];
+ *   char     oids[n_commits][GIT_OID_RAWSZ];   (sorted)
+ *   uint32_t generation[n_commits];
+ *   uint32_t parent_start[n_commits + 1];
+ *   uint32_t parents[n_edges];
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <git2.h>
+#include "utils.h"
+#include "graph.h"
+
+#define COMMIT_GRAPH_MAGIC "PGCG"
+#define COMMIT_GRAPH_VERSION 1
+#define COMMIT_GRAPH_BYTE_ORDER 0x01020304
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t n_commits;
+    uint32_t n_edges;
+    uint32_t reserved;
+} CommitGraphHeader;
+
+/* Flags used while painting the graph */
+#define PARENT1 1
+#define PARENT2 2
+#define QUEUED  4
+#define STALE   8  /* An ancestor of a merge base found already */
+
+static size_t
+commit_graph_size(uint32_t n_commits, uint32_t n_edges)
+{
+    return sizeof(CommitGraphHeader) +
+           (size_t)n_commits * (sizeof(int64_t) + GIT_OID_RAWSZ +
+                                2 * sizeof(uint32_t)) +
+           sizeof(uint32_t) + (size_t)n_edges * sizeof(uint32_t);
+}
+
+static void
+commit_graph_setup(CommitGraph *graph, char *data)
+{
+    const CommitGraphHeader *header = (const CommitGraphHeader *)data;
+    char *ptr = data + sizeof(CommitGraphHeader);
+    uint32_t n = header->n_commits;
+
+    graph->refcount = 1;
+    graph->bitmaps = NULL;
+    graph->data = data;
+    graph->n_commits = n;
+    graph->n_edges = header->n_edges;
+    graph->time = (const int64_t *)ptr;
+    ptr += n * sizeof(int64_t);
+    graph->oids = (const unsigned char *)ptr;
+    ptr += (size_t)n * GIT_OID_RAWSZ;
+    graph->generation = (const uint32_t *)ptr;
+    ptr += n * sizeof(uint32_t);
+    graph->parent_start = (const uint32_t *)ptr;
+    ptr += (n + 1) * sizeof(uint32_t);
+    graph->parents = (const uint32_t *)ptr;
+}
+
+static int
+corrupted(void)
+{
+    giterr_set_str(GITERR_ODB, "corrupted commit-graph file");
+    return GIT_ERROR;
+}
+
+int
+commit_graph_open(CommitGraph **out, const char *path)
+{
+    CommitGraphHeader header;
+    CommitGraph *graph = NULL;
+    char *data = NULL;
+    FILE *fp;
+    long size;
+    uint32_t i;
+    int err = GIT_ERROR;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL)
+        return GIT_ENOTFOUND;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        memcmp(header.magic, COMMIT_GRAPH_MAGIC, 4) != 0 ||
+        header.version != COMMIT_GRAPH_VERSION ||
+        header.byte_order != COMMIT_GRAPH_BYTE_ORDER) {
+        err = corrupted();
+        goto exit;
+    }
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+        (size_t)size != commit_graph_size(header.n_commits, header.n_edges)) {
+        err = corrupted();
+        goto exit;
+    }
+
+    MALLOC(data, size, exit);
+    MALLOC(graph, sizeof(CommitGraph), exit);
+    if (fseek(fp, 0, SEEK_SET) != 0 || fread(data, size, 1, fp) != 1) {
+        giterr_set_str(GITERR_OS, "failed to read the commit-graph file");
+        err = GIT_ERROR;
+        goto exit;
+    }
+
+    commit_graph_setup(graph, data);
+
+    /* Check the offsets once, queries trust them */
+    err = GIT_ERROR;
+    if (graph->parent_start[0] != 0 ||
+        graph->parent_start[graph->n_commits] != graph->n_edges) {
+        corrupted();
+        goto exit;
+    }
+    for (i = 0; i < graph->n_commits; i++) {
+        if (graph->parent_start[i] > graph->parent_start[i + 1]) {
+            corrupted();
+            goto exit;
+        }
+    }
+    for (i = 0; i < graph->n_edges; i++) {
+        if (graph->parents[i] >= graph->n_commits) {
+            corrupted();
+            goto exit;
+        }
+    }
+
+    *out = graph;
+    graph = NULL;
+    data = NULL;
+    err = 0;
+
+exit:
+    fclose(fp);
+    free(graph);
+    free(data);
+    return err;
+}
+
+void
+commit_graph_incref(CommitGraph *graph)
+{
+    graph->refcount++;
+}
+
+void
+commit_graph_decref(CommitGraph *graph)
+{
+    ReachBitmap *bitmap, *next;
+
+    if (graph == NULL || --graph->refcount > 0)
+        return;
+
+    for (bitmap = graph->bitmaps; bitmap != NULL; bitmap = next) {
+        next = bitmap->next;
+        reach_bitmap_decref(bitmap);
+    }
+
+    free(graph->data);
+    free(graph);
+}
+
+int
+commit_graph_find(const CommitGraph *graph, const git_oid *oid,
+                  uint32_t *pos)
+{
+    uint32_t lo = 0, hi = graph->n_commits, mid;
+    int cmp;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        cmp = git_oid_cmp(oid, COMMIT_GRAPH_OID(graph, mid));
+        if (cmp == 0) {
+            *pos = mid;
+            return 1;
+        }
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    return 0;
+}
+
+
+/*
+ * Writing
+ */
+
+/* Grow *ptr so it can hold at least n items */
+static int
+grow(void **ptr, size_t *alloc, size_t n, size_t item_size)
+{
+    size_t new_alloc;
+    void *new_ptr;
+
+    if (n <= *alloc)
+        return 0;
+
+    new_alloc = *alloc ? *alloc : 1024;
+    while (new_alloc < n)
+        new_alloc *= 2;
+
+    new_ptr = realloc(*ptr, new_alloc * item_size);
+    if (new_ptr == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+
+    *ptr = new_ptr;
+    *alloc = new_alloc;
+    return 0;
+}
+
+typedef struct {
+    git_oid oid;
+    uint32_t topo;  /* Position in the topological order */
+} SortEntry;
+
+static int
+sort_entry_cmp(const void *a, const void *b)
+{
+    return git_oid_cmp(&((const SortEntry *)a)->oid,
+                       &((const SortEntry *)b)->oid);
+}
+
+static int
+sorted_find(const SortEntry *entries, uint32_t n, const git_oid *oid,
+            uint32_t *pos)
+{
+    SortEntry key, *entry;
+
+    git_oid_cpy(&key.oid, oid);
+    entry = bsearch(&key, entries, n, sizeof(SortEntry), sort_entry_cmp);
+    if (entry == NULL) {
+        giterr_set_str(GITERR_INVALID,
+                       "commit parent missing from the history walk");
+        return GIT_ENOTFOUND;
+    }
+
+    *pos = (uint32_t)(entry - entries);
+    return 0;
+}
+
+static int
+write_file(const char *path, const char *data, size_t size)
+{
+    char *tmp_path;
+    FILE *fp;
+    int err;
+
+    tmp_path = malloc(strlen(path) + 5);
+    if (tmp_path == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+
+    fp = fopen(tmp_path, "wb");
+    if (fp == NULL) {
+        giterr_set_str(GITERR_OS, "failed to create the commit-graph file");
+        free(tmp_path);
+        return GIT_ERROR;
+    }
+
+    err = fwrite(data, size, 1, fp) == 1 ? 0 : GIT_ERROR;
+    if (fclose(fp) != 0)
+        err = GIT_ERROR;
+
+#ifdef _WIN32
+    /* rename() does not replace existing files on Windows */
+    if (err == 0)
+        remove(path);
+#endif
+    if (err == 0 && rename(tmp_path, path) != 0)
+        err = GIT_ERROR;
+
+    if (err < 0) {
+        giterr_set_str(GITERR_OS, "failed to write the commit-graph file");
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    return err;
+}
+
+int
+commit_graph_write(size_t *count, git_repository *repo, const char *path)
+{
+    git_revwalk *walk = NULL;
+    git_commit *commit;
+    git_oid oid;
+    /* The commits in topological order, parents first */
+    git_oid *topo_oids = NULL, *topo_parents = NULL;
+    int64_t *topo_time = NULL;
+    uint32_t *topo_start = NULL, *topo_generation = NULL;
+    size_t n = 0, n_alloc = 0, start_alloc = 0, e = 0, e_alloc = 0;
+    size_t time_alloc = 0;
+    SortEntry *entries = NULL;
+    CommitGraphHeader *header;
+    CommitGraph graph;
+    char *data = NULL;
+    uint32_t i, j, t, pos, gen;
+    int64_t *time;
+    unsigned char *oids;
+    uint32_t *generation, *parent_start, *parents;
+    unsigned int k, parent_count;
+    int err;
+
+    err = git_revwalk_new(&walk, repo);
+    if (err < 0)
+        return err;
+
+    git_revwalk_sorting(walk, GIT_SORT_TOPOLOGICAL | GIT_SORT_REVERSE);
+    err = git_revwalk_push_glob(walk, "*");
+    if (err < 0)
+        goto exit;
+
+    err = git_revwalk_push_head(walk);
+    if (err == GIT_ENOTFOUND || err == GIT_EUNBORNBRANCH) {
+        giterr_clear();
+        err = 0;
+    }
+    if (err < 0)
+        goto exit;
+
+    /* 1- Walk the history, parents first */
+    while ((err = git_revwalk_next(&oid, walk)) == 0) {
+        if (n == UINT32_MAX - 1) {
+            giterr_set_str(GITERR_INVALID, "too many commits");
+            err = GIT_ERROR;
+            goto exit;
+        }
+
+        err = git_commit_lookup(&commit, repo, &oid);
+        if (err < 0)
+            goto exit;
+
+        parent_count = git_commit_parentcount(commit);
+        if ((err = grow((void **)&topo_oids, &n_alloc, n + 1,
+                        sizeof(git_oid))) < 0 ||
+            (err = grow((void **)&topo_time, &time_alloc, n + 1,
+                        sizeof(int64_t))) < 0 ||
+            (err = grow((void **)&topo_start, &start_alloc, n + 2,
+                        sizeof(uint32_t))) < 0 ||
+            (err = grow((void **)&topo_parents, &e_alloc, e + parent_count,
+                        sizeof(git_oid))) < 0) {
+            git_commit_free(commit);
+            goto exit;
+        }
+
+        git_oid_cpy(&topo_oids[n], &oid);
+        topo_time[n] = git_commit_time(commit);
+        topo_start[n] = (uint32_t)e;
+        for (k = 0; k < parent_count; k++)
+            git_oid_cpy(&topo_parents[e++], git_commit_parent_id(commit, k));
+        topo_start[n + 1] = (uint32_t)e;
+        n++;
+
+        git_commit_free(commit);
+    }
+    if (err != GIT_ITEROVER)
+        goto exit;
+    err = 0;
+
+    /* 2- Sort by oid */
+    CALLOC(entries, n ? n : 1, sizeof(SortEntry), exit);
+    CALLOC(topo_generation, n ? n : 1, sizeof(uint32_t), exit);
+    for (i = 0; i < n; i++) {
+        git_oid_cpy(&entries[i].oid, &topo_oids[i]);
+        entries[i].topo = i;
+    }
+    qsort(entries, n, sizeof(SortEntry), sort_entry_cmp);
+
+    /* 3- Generation numbers, parents come before their children */
+    for (t = 0; t < n; t++) {
+        gen = 0;
+        for (j = topo_start[t]; j < topo_start[t + 1]; j++) {
+            err = sorted_find(entries, (uint32_t)n, &topo_parents[j], &pos);
+            if (err < 0)
+                goto exit;
+            if (topo_generation[entries[pos].topo] > gen)
+                gen = topo_generation[entries[pos].topo];
+        }
+        topo_generation[t] = gen + 1;
+    }
+
+    /* 4- Lay out the file */
+    MALLOC(data, commit_graph_size((uint32_t)n, (uint32_t)e), exit);
+    header = (CommitGraphHeader *)data;
+    memcpy(header->magic, COMMIT_GRAPH_MAGIC, 4);
+    header->version = COMMIT_GRAPH_VERSION;
+    header->byte_order = COMMIT_GRAPH_BYTE_ORDER;
+    header->n_commits = (uint32_t)n;
+    header->n_edges = (uint32_t)e;
+    header->reserved = 0;
+
+    commit_graph_setup(&graph, data);
+    time = (int64_t *)graph.time;
+    oids = (unsigned char *)graph.oids;
+    generation = (uint32_t *)graph.generation;
+    parent_start = (uint32_t *)graph.parent_start;
+    parents = (uint32_t *)graph.parents;
+
+    parent_start[0] = 0;
+    for (i = 0, j = 0; i < n; i++) {
+        t = entries[i].topo;
+        time[i] = topo_time[t];
+        memcpy(oids + (size_t)i * GIT_OID_RAWSZ, entries[i].oid.id,
+               GIT_OID_RAWSZ);
+        generation[i] = topo_generation[t];
+        for (k = topo_start[t]; k < topo_start[t + 1]; k++) {
+            err = sorted_find(entries, (uint32_t)n, &topo_parents[k], &pos);
+            if (err < 0)
+                goto exit;
+            parents[j++] = pos;
+        }
+        parent_start[i + 1] = j;
+    }
+
+    err = write_file(path, data, commit_graph_size((uint32_t)n, (uint32_t)e));
+    if (err < 0)
+        goto exit;
+
+    *count = n;
+
+exit:
+    git_revwalk_free(walk);
+    free(topo_oids);
+    free(topo_parents);
+    free(topo_time);
+    free(topo_start);
+    free(topo_generation);
+    free(entries);
+    free(data);
+    return err;
+}
+
+
+/*
+ * Queries.  Commits are processed by decreasing generation number, so by the
+ * time a commit is popped every descendant of it that is being painted has
+ * been processed already, and its flags are final.
+ */
+
+typedef struct {
+    const CommitGraph *graph;
+    uint32_t *items;
+    size_t size;
+    size_t alloc;
+} CommitQueue;
+
+/* Higher generation first, then newer first */
+static int
+queue_before(const CommitGraph *graph, uint32_t a, uint32_t b)
+{
+    if (graph->generation[a] != graph->generation[b])
+        return graph->generation[a] > graph->generation[b];
+
+    return graph->time[a] > graph->time[b];
+}
+
+static int
+queue_push(CommitQueue *queue, uint32_t pos)
+{
+    size_t i, parent;
+    uint32_t tmp;
+    int err;
+
+    err = grow((void **)&queue->items, &queue->alloc, queue->size + 1,
+               sizeof(uint32_t));
+    if (err < 0)
+        return err;
+
+    i = queue->size++;
+    queue->items[i] = pos;
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!queue_before(queue->graph, queue->items[i], queue->items[parent]))
+            break;
+        tmp = queue->items[i];
+        queue->items[i] = queue->items[parent];
+        queue->items[parent] = tmp;
+        i = parent;
+    }
+
+    return 0;
+}
+
+static uint32_t
+queue_pop(CommitQueue *queue)
+{
+    uint32_t top = queue->items[0], tmp;
+    size_t i = 0, child, size;
+
+    size = --queue->size;
+    queue->items[0] = queue->items[size];
+    for (;;) {
+        child = 2 * i + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size &&
+            queue_before(queue->graph, queue->items[child + 1],
+                         queue->items[child]))
+            child++;
+        if (!queue_before(queue->graph, queue->items[child], queue->items[i]))
+            break;
+        tmp = queue->items[i];
+        queue->items[i] = queue->items[child];
+        queue->items[child] = tmp;
+        i = child;
+    }
+
+    return top;
+}
+
+/* The state of a query.  A batch reuses it across its pairs, resetting only
+ * the flags of the commits the previous pair touched. */
+typedef struct {
+    CommitQueue queue;
+    unsigned char *flags;
+    uint32_t *touched;
+    size_t n_touched;
+    size_t touched_alloc;
+    size_t pending;  /* Queued commits not yet reached from both sides */
+    size_t fresh;    /* Queued commits not stale */
+} Painter;
+
+static int
+painter_init(Painter *painter, const CommitGraph *graph)
+{
+    memset(painter, 0, sizeof(Painter));
+    painter->queue.graph = graph;
+    painter->flags = calloc(graph->n_commits ? graph->n_commits : 1, 1);
+    if (painter->flags == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+
+    return 0;
+}
+
+static void
+painter_reset(Painter *painter)
+{
+    size_t i;
+
+    for (i = 0; i < painter->n_touched; i++)
+        painter->flags[painter->touched[i]] = 0;
+    painter->n_touched = 0;
+    painter->queue.size = 0;
+    painter->pending = 0;
+    painter->fresh = 0;
+}
+
+static void
+painter_free(Painter *painter)
+{
+    free(painter->queue.items);
+    free(painter->flags);
+    free(painter->touched);
+}
+
+/* Adds paint to the flags of pos, queueing it the first time */
+static int
+painter_paint(Painter *painter, uint32_t pos, unsigned char paint)
+{
+    unsigned char *flags = &painter->flags[pos];
+    int err;
+
+    if ((*flags & paint) == paint)
+        return 0;
+
+    if (!(*flags & QUEUED)) {
+        err = grow((void **)&painter->touched, &painter->touched_alloc,
+                   painter->n_touched + 1, sizeof(uint32_t));
+        if (err < 0)
+            return err;
+        err = queue_push(&painter->queue, pos);
+        if (err < 0)
+            return err;
+        painter->touched[painter->n_touched++] = pos;
+        if (paint != (PARENT1 | PARENT2))
+            painter->pending++;
+        if (!(paint & STALE))
+            painter->fresh++;
+    } else if ((*flags | paint) == (QUEUED | PARENT1 | PARENT2)) {
+        painter->pending--;
+    }
+
+    /* A queued commit is never popped before its descendants, so one
+     * being painted has not been popped yet */
+    if ((*flags & (QUEUED | STALE)) == QUEUED && (paint & STALE))
+        painter->fresh--;
+
+    *flags |= paint | QUEUED;
+    return 0;
+}
+
+static int
+painter_start(Painter *painter, uint32_t one, uint32_t two)
+{
+    int err;
+
+    painter_reset(painter);
+    err = painter_paint(painter, one, PARENT1);
+    if (err == 0)
+        err = painter_paint(painter, two, PARENT2);
+
+    return err;
+}
+
+/* Pops the next commit and paints its parents with its flags */
+static int
+painter_next(Painter *painter, uint32_t *pos, unsigned char *flags)
+{
+    const CommitGraph *graph = painter->queue.graph;
+    uint32_t i;
+    int err;
+
+    *pos = queue_pop(&painter->queue);
+    *flags = painter->flags[*pos] & (PARENT1 | PARENT2 | STALE);
+    if ((*flags & (PARENT1 | PARENT2)) != (PARENT1 | PARENT2))
+        painter->pending--;
+    if (!(*flags & STALE))
+        painter->fresh--;
+
+    for (i = graph->parent_start[*pos]; i < graph->parent_start[*pos + 1];
+         i++) {
+        err = painter_paint(painter, graph->parents[i], *flags);
+        if (err < 0)
+            return err;
+    }
+
+    return 0;
+}
+
+/*
+ * The first commit reached from both sides is a best common ancestor: any
+ * common ancestor descending from it would have come first.  It is painted
+ * stale, along with its ancestors, and the walk goes on until only stale
+ * commits are queued; a commit reached from both sides by then, and not
+ * stale, is another best common ancestor (as in git's paint_down_to_common).
+ * libgit2 has its own order to choose among several, so that case returns
+ * GIT_EAMBIGUOUS for the caller to fall back to git_merge_base().
+ */
+static int
+merge_base(uint32_t *out, Painter *painter, uint32_t one, uint32_t two)
+{
+    uint32_t pos;
+    unsigned char flags;
+    int found = 0, err;
+
+    err = painter_start(painter, one, two);
+    if (err < 0)
+        return err;
+
+    while (painter->fresh > 0) {
+        pos = painter->queue.items[0];
+        if ((painter->flags[pos] & (PARENT1 | PARENT2 | STALE)) ==
+            (PARENT1 | PARENT2)) {
+            if (found) {
+                giterr_set_str(GITERR_MERGE, "More than one merge base");
+                return GIT_EAMBIGUOUS;
+            }
+            *out = pos;
+            found = 1;
+            painter->flags[pos] |= STALE;
+            painter->fresh--;
+        }
+
+        err = painter_next(painter, &pos, &flags);
+        if (err < 0)
+            return err;
+    }
+
+    if (found)
+        return 0;
+
+    giterr_set_str(GITERR_MERGE, "No merge base found");
+    return GIT_ENOTFOUND;
+}
+
+static int
+ahead_behind(size_t *ahead, size_t *behind, Painter *painter,
+             uint32_t local, uint32_t upstream)
+{
+    uint32_t pos;
+    unsigned char flags;
+    int err;
+
+    *ahead = *behind = 0;
+    err = painter_start(painter, local, upstream);
+    if (err < 0)
+        return err;
+
+    /* Once every queued commit is reached from both sides, the rest of the
+     * history is common */
+    while (painter->pending > 0) {
+        err = painter_next(painter, &pos, &flags);
+        if (err < 0)
+            return err;
+
+        if (flags == PARENT1)
+            (*ahead)++;
+        else if (flags == PARENT2)
+            (*behind)++;
+    }
+
+    return 0;
+}
+
+int
+commit_graph_merge_base(uint32_t *out, const CommitGraph *graph,
+                        uint32_t one, uint32_t two)
+{
+    Painter painter;
+    int err;
+
+    err = painter_init(&painter, graph);
+    if (err == 0)
+        err = merge_base(out, &painter, one, two);
+
+    painter_free(&painter);
+    return err;
+}
+
+int
+commit_graph_ahead_behind(size_t *ahead, size_t *behind,
+                          const CommitGraph *graph,
+                          uint32_t local, uint32_t upstream)
+{
+    Painter painter;
+    int err;
+
+    err = painter_init(&painter, graph);
+    if (err == 0)
+        err = ahead_behind(ahead, behind, &painter, local, upstream);
+
+    painter_free(&painter);
+    return err;
+}
+
+typedef struct {
+    uint32_t tip;
+    size_t index;
+} BatchItem;
+
+static int
+batch_item_cmp(const void *a, const void *b)
+{
+    uint32_t tip_a = ((const BatchItem *)a)->tip;
+    uint32_t tip_b = ((const BatchItem *)b)->tip;
+
+    return tip_a < tip_b ? -1 : tip_a > tip_b;
+}
+
+/* Sorts the tips so that repeated ones are computed once */
+static BatchItem *
+batch_sort(const uint32_t *tips, size_t n)
+{
+    BatchItem *items;
+    size_t i;
+
+    items = malloc((n ? n : 1) * sizeof(BatchItem));
+    if (items == NULL) {
+        giterr_set_oom();
+        return NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        items[i].tip = tips[i];
+        items[i].index = i;
+    }
+    qsort(items, n, sizeof(BatchItem), batch_item_cmp);
+    return items;
+}
+
+int
+commit_graph_merge_base_many(uint32_t *out, int *found,
+                             const CommitGraph *graph,
+                             const uint32_t *tips, size_t n, uint32_t base)
+{
+    Painter painter;
+    BatchItem *items = NULL;
+    size_t i, index, prev = 0;
+    int err;
+
+    err = painter_init(&painter, graph);
+    if (err < 0)
+        goto exit;
+
+    items = batch_sort(tips, n);
+    if (items == NULL) {
+        err = GIT_ERROR;
+        goto exit;
+    }
+
+    for (i = 0; i < n; i++) {
+        index = items[i].index;
+        if (i > 0 && items[i].tip == items[i - 1].tip) {
+            out[index] = out[prev];
+            found[index] = found[prev];
+            continue;
+        }
+
+        err = merge_base(&out[index], &painter, items[i].tip, base);
+        found[index] = err == 0 ? 1 : err == GIT_EAMBIGUOUS ? -1 : 0;
+        if (err == GIT_ENOTFOUND || err == GIT_EAMBIGUOUS) {
+            giterr_clear();
+            err = 0;
+        }
+        if (err < 0)
+            goto exit;
+        prev = index;
+    }
+
+exit:
+    free(items);
+    painter_free(&painter);
+    return err;
+}
+
+int
+commit_graph_ahead_behind_many(size_t *ahead, size_t *behind,
+                               const CommitGraph *graph,
+                               const uint32_t *tips, size_t n,
+                               uint32_t upstream)
+{
+    Painter painter;
+    BatchItem *items = NULL;
+    size_t i, index, prev = 0;
+    int err;
+
+    err = painter_init(&painter, graph);
+    if (err < 0)
+        goto exit;
+
+    items = batch_sort(tips, n);
+    if (items == NULL) {
+        err = GIT_ERROR;
+        goto exit;
+    }
+
+    for (i = 0; i < n; i++) {
+        index = items[i].index;
+        if (i > 0 && items[i].tip == items[i - 1].tip) {
+            ahead[index] = ahead[prev];
+            behind[index] = behind[prev];
+            continue;
+        }
+
+        err = ahead_behind(&ahead[index], &behind[index], &painter,
+                           items[i].tip, upstream);
+        if (err < 0)
+            goto exit;
+        prev = index;
+    }
+
+exit:
+    free(items);
+    painter_free(&painter);
+    return err;
+}
+
+
+/*
+ * Reachability bitmaps.  The bitmaps of the last tips queried are kept on
+ * the graph; a new one is seeded from those of its ancestors, so moving a
+ * reference forward only costs the walk over the new commits.
+ */
+
+void
+reach_bitmap_decref(ReachBitmap *bitmap)
+{
+    if (bitmap == NULL || --bitmap->refcount > 0)
+        return;
+
+    free(bitmap->bits);
+    free(bitmap);
+}
+
+/* Returns a new reference to the cached bitmap of tip, or NULL */
+ReachBitmap *
+commit_graph_get_bitmap(CommitGraph *graph, uint32_t tip)
+{
+    ReachBitmap **prev, *bitmap;
+
+    for (prev = &graph->bitmaps; *prev != NULL; prev = &(*prev)->next) {
+        bitmap = *prev;
+        if (bitmap->tip == tip) {
+            *prev = bitmap->next;
+            bitmap->next = graph->bitmaps;
+            graph->bitmaps = bitmap;
+            bitmap->refcount++;
+            return bitmap;
+        }
+    }
+
+    return NULL;
+}
+
+/* Fills out, which must hold COMMIT_GRAPH_MAX_BITMAPS items, with new
+ * references to the cached bitmaps */
+size_t
+commit_graph_get_bitmaps(CommitGraph *graph, ReachBitmap **out)
+{
+    ReachBitmap *bitmap;
+    size_t n = 0;
+
+    for (bitmap = graph->bitmaps; bitmap != NULL; bitmap = bitmap->next) {
+        bitmap->refcount++;
+        out[n++] = bitmap;
+    }
+
+    return n;
+}
+
+/* Steals the reference to bitmap */
+void
+commit_graph_add_bitmap(CommitGraph *graph, ReachBitmap *bitmap)
+{
+    ReachBitmap **prev, *old;
+    size_t n = 1;
+
+    bitmap->next = graph->bitmaps;
+    graph->bitmaps = bitmap;
+
+    /* Drop another bitmap for the same tip, and the least recently used
+     * one past the limit */
+    for (prev = &bitmap->next; *prev != NULL; ) {
+        old = *prev;
+        if (old->tip == bitmap->tip || n == COMMIT_GRAPH_MAX_BITMAPS) {
+            *prev = old->next;
+            reach_bitmap_decref(old);
+            continue;
+        }
+        prev = &old->next;
+        n++;
+    }
+}
+
+static size_t
+popcount64(uint64_t x)
+{
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+    return (size_t)((x * 0x0101010101010101ULL) >> 56);
+}
+
+int
+commit_graph_compute_bitmap(ReachBitmap **out, const CommitGraph *graph,
+                            uint32_t tip, ReachBitmap **bases,
+                            size_t n_bases)
+{
+    ReachBitmap *bitmap = NULL;
+    uint32_t *stack = NULL, pos, i;
+    size_t n_words, size = 0, alloc = 0, j, k;
+    int err = 0;
+
+    MALLOC(bitmap, sizeof(ReachBitmap), exit);
+    n_words = ((size_t)graph->n_commits + 63) / 64;
+    CALLOC(bitmap->bits, n_words ? n_words : 1, sizeof(uint64_t), exit);
+    bitmap->refcount = 1;
+    bitmap->tip = tip;
+    bitmap->next = NULL;
+
+    err = grow((void **)&stack, &alloc, 1, sizeof(uint32_t));
+    if (err < 0)
+        goto exit;
+    stack[size++] = tip;
+
+    while (size > 0) {
+        pos = stack[--size];
+        if (REACH_BITMAP_TEST(bitmap, pos))
+            continue;
+        bitmap->bits[pos / 64] |= (uint64_t)1 << (pos % 64);
+
+        /* Everything reachable from a known tip is known */
+        for (k = 0; k < n_bases; k++) {
+            if (bases[k]->tip == pos)
+                break;
+        }
+        if (k < n_bases) {
+            for (j = 0; j < n_words; j++)
+                bitmap->bits[j] |= bases[k]->bits[j];
+            continue;
+        }
+
+        for (i = graph->parent_start[pos]; i < graph->parent_start[pos + 1];
+             i++) {
+            if (REACH_BITMAP_TEST(bitmap, graph->parents[i]))
+                continue;
+            err = grow((void **)&stack, &alloc, size + 1, sizeof(uint32_t));
+            if (err < 0)
+                goto exit;
+            stack[size++] = graph->parents[i];
+        }
+    }
+
+    bitmap->count = 0;
+    for (j = 0; j < n_words; j++)
+        bitmap->count += popcount64(bitmap->bits[j]);
+
+    *out = bitmap;
+    bitmap = NULL;
+
+exit:
+    if (bitmap != NULL) {
+        free(bitmap->bits);
+        free(bitmap);
+    }
+    free(stack);
+    return err;
+}
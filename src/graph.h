@@ -0,0 +1,115 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef INCLUDE_pygit2_graph_h
+#define INCLUDE_pygit2_graph_h
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <git2.h>
+#include "types.h"
+
+/* Where write_commit_graph() and the lazy loading look by default,
+ * relative to the repository path (the .git directory) */
+#define COMMIT_GRAPH_FILE "objects/info/pygit2-commit-graph"
+
+/*
+ * A loaded commit-graph file.  Commits are numbered by their position in
+ * the sorted oid table; the graph is closed under ancestry, so every
+ * parent of a commit in the graph is in the graph too.
+ *
+ * The commit tables are immutable once loaded, so they can be read with
+ * the GIL released.  The refcounts of the graph and of its bitmaps, and the
+ * most recently used list of bitmaps, change as the bitmaps are used: they
+ * are only ever touched with the GIL held.
+ */
+/* The commits reachable from a tip, one bit per graph position */
+typedef struct ReachBitmap {
+    size_t refcount;
+    uint32_t tip;
+    size_t count;                    /* Bits set, the tip included */
+    uint64_t *bits;
+    struct ReachBitmap *next;        /* Most recently used first */
+} ReachBitmap;
+
+#define COMMIT_GRAPH_MAX_BITMAPS 16
+
+#define REACH_BITMAP_TEST(bitmap, pos) \
+        (((bitmap)->bits[(pos) / 64] >> ((pos) % 64)) & 1)
+
+struct CommitGraph {
+    size_t refcount;
+    ReachBitmap *bitmaps;            /* Cache of the last bitmaps used */
+    char *data;                      /* The whole file */
+    uint32_t n_commits;
+    uint32_t n_edges;
+    const int64_t *time;             /* Commit times */
+    const unsigned char *oids;       /* Sorted raw oids */
+    const uint32_t *generation;      /* 1 + the max generation of parents */
+    const uint32_t *parent_start;    /* n_commits + 1 offsets into parents */
+    const uint32_t *parents;
+};
+
+#define COMMIT_GRAPH_OID(graph, pos) \
+        ((const git_oid *)((graph)->oids + (size_t)(pos) * GIT_OID_RAWSZ))
+
+/* These functions do not need the GIL, errors are reported libgit2 style */
+int commit_graph_open(CommitGraph **out, const char *path);
+int commit_graph_write(size_t *count, git_repository *repo, const char *path);
+int commit_graph_find(const CommitGraph *graph, const git_oid *oid,
+                      uint32_t *pos);
+int commit_graph_merge_base(uint32_t *out, const CommitGraph *graph,
+                            uint32_t one, uint32_t two);
+int commit_graph_ahead_behind(size_t *ahead, size_t *behind,
+                              const CommitGraph *graph,
+                              uint32_t local, uint32_t upstream);
+
+/* found[i] is 1 when out[i] is the merge base of tips[i] and base, 0 when
+ * they have none, and -1 when they have several (the graph does not choose
+ * among them as libgit2 does, nor does commit_graph_merge_base(), which
+ * returns GIT_EAMBIGUOUS) */
+int commit_graph_merge_base_many(uint32_t *out, int *found,
+                                 const CommitGraph *graph,
+                                 const uint32_t *tips, size_t n,
+                                 uint32_t base);
+int commit_graph_ahead_behind_many(size_t *ahead, size_t *behind,
+                                   const CommitGraph *graph,
+                                   const uint32_t *tips, size_t n,
+                                   uint32_t upstream);
+int commit_graph_compute_bitmap(ReachBitmap **out, const CommitGraph *graph,
+                                uint32_t tip, ReachBitmap **bases,
+                                size_t n_bases);
+
+/* These need the GIL */
+void commit_graph_incref(CommitGraph *graph);
+void commit_graph_decref(CommitGraph *graph);
+ReachBitmap* commit_graph_get_bitmap(CommitGraph *graph, uint32_t tip);
+size_t commit_graph_get_bitmaps(CommitGraph *graph, ReachBitmap **out);
+void commit_graph_add_bitmap(CommitGraph *graph, ReachBitmap *bitmap);
+void reach_bitmap_decref(ReachBitmap *bitmap);
+
+#endif
@@ -33,6 +33,8 @@
 #include "oid.h"
 #include "repository.h"
 #include "object.h"
+#include "odb.h"
+#include "objectcache.h"
 
 extern PyTypeObject TreeType;
 extern PyTypeObject CommitType;
@@ -43,11 +45,23 @@ extern PyTypeObject TagType;
 void
 Object_dealloc(Object* self)
 {
+    PyObject_GC_UnTrack(self);
+    if (self->weakreflist != NULL)
+        PyObject_ClearWeakRefs((PyObject *)self);
     Py_CLEAR(self->repo);
     git_object_free(self->obj);
     Py_TYPE(self)->tp_free(self);
 }
 
+/* Objects are GC tracked, instances of Python subclasses may be part of
+ * reference cycles through the repository */
+int
+Object_traverse(Object *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->repo);
+    return 0;
+}
+
 
 PyDoc_STRVAR(Object_id__doc__,
     "The object id, an instance of the Oid type.");
@@ -135,6 +149,24 @@ Object_read_raw(Object *self)
     return aux;
 }
 
+PyDoc_STRVAR(Object_read_buffer__doc__,
+  "read_buffer() -> OdbObject\n"
+  "\n"
+  "Returns the raw contents of the object, without copying them.");
+
+PyObject *
+Object_read_buffer(Object *self)
+{
+    git_odb_object *obj;
+
+    obj = Repository_read_raw(self->repo->repo, git_object_id(self->obj),
+                              GIT_OID_HEXSZ);
+    if (obj == NULL)
+        return NULL;
+
+    return wrap_odb_object(obj);
+}
+
 PyDoc_STRVAR(Object_peel__doc__,
   "peel(target_type) -> Object\n"
   "\n"
@@ -168,6 +200,7 @@ PyGetSetDef Object_getseters[] = {
 
 PyMethodDef Object_methods[] = {
     METHOD(Object, read_raw, METH_NOARGS),
+    METHOD(Object, read_buffer, METH_NOARGS),
     METHOD(Object, peel, METH_O),
     {NULL}
 };
@@ -195,12 +228,14 @@ PyTypeObject ObjectType = {
     0,                                         /* tp_getattro       */
     0,                                         /* tp_setattro       */
     0,                                         /* tp_as_buffer      */
-    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE,  /* tp_flags          */
+    Py_TPFLAGS_DEFAULT |
+    Py_TPFLAGS_BASETYPE |
+    Py_TPFLAGS_HAVE_GC,                        /* tp_flags          */
     Object__doc__,                             /* tp_doc            */
-    0,                                         /* tp_traverse       */
+    (traverseproc)Object_traverse,             /* tp_traverse       */
     0,                                         /* tp_clear          */
     0,                                         /* tp_richcompare    */
-    0,                                         /* tp_weaklistoffset */
+    offsetof(Object, weakreflist),             /* tp_weaklistoffset */
     0,                                         /* tp_iter           */
     0,                                         /* tp_iternext       */
     Object_methods,                            /* tp_methods        */
@@ -216,34 +251,87 @@ PyTypeObject ObjectType = {
     0,                                         /* tp_new            */
 };
 
+/* Wraps an object that is not in the repository's cache, and adds it there */
 PyObject *
-wrap_object(git_object *c_object, Repository *repo)
+wrap_new_object(git_object *c_object, Repository *repo)
 {
     Object *py_obj = NULL;
 
     switch (git_object_type(c_object)) {
         case GIT_OBJ_COMMIT:
-            py_obj = PyObject_New(Object, &CommitType);
+            py_obj = PyObject_GC_New(Object, &CommitType);
             break;
         case GIT_OBJ_TREE:
-            py_obj = PyObject_New(Object, &TreeType);
+            py_obj = PyObject_GC_New(Object, &TreeType);
             break;
         case GIT_OBJ_BLOB:
-            py_obj = PyObject_New(Object, &BlobType);
+            py_obj = PyObject_GC_New(Object, &BlobType);
             break;
         case GIT_OBJ_TAG:
-            py_obj = PyObject_New(Object, &TagType);
+            py_obj = PyObject_GC_New(Object, &TagType);
             break;
         default:
             assert(0);
     }
 
-    if (py_obj) {
-        py_obj->obj = c_object;
-        if (repo) {
-            py_obj->repo = repo;
-            Py_INCREF(repo);
-        }
+    if (py_obj == NULL) {
+        git_object_free(c_object);
+        return NULL;
     }
+
+    py_obj->obj = c_object;
+    py_obj->repo = repo;
+    py_obj->weakreflist = NULL;
+    Py_XINCREF(repo);
+    PyObject_GC_Track(py_obj);
+
+    if (repo != NULL &&
+        ObjectCache_put(&repo->cache, git_object_id(c_object),
+                        (PyObject *)py_obj) < 0) {
+        Py_DECREF(py_obj);
+        return NULL;
+    }
+
     return (PyObject *)py_obj;
 }
+
+PyObject *
+wrap_object(git_object *c_object, Repository *repo)
+{
+    PyObject *py_obj;
+
+    if (repo != NULL) {
+        py_obj = ObjectCache_get(&repo->cache, git_object_id(c_object));
+        if (py_obj != NULL) {
+            git_object_free(c_object);
+            return py_obj;
+        }
+    }
+
+    return wrap_new_object(c_object, repo);
+}
+
+/* Looks the object up, going to the object database only on a cache miss */
+PyObject *
+lookup_object(Repository *repo, const git_oid *oid, git_otype type)
+{
+    git_object *obj;
+    PyObject *py_obj;
+    int err;
+
+    py_obj = ObjectCache_get(&repo->cache, oid);
+    if (py_obj != NULL) {
+        if (type == GIT_OBJ_ANY ||
+            git_object_type(((Object *)py_obj)->obj) == type)
+            return py_obj;
+        Py_DECREF(py_obj);
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_object_lookup(&obj, repo->repo, oid, type);
+    Py_END_ALLOW_THREADS
+    if (err < 0)
+        return Error_set_oid(err, oid, GIT_OID_HEXSZ);
+
+    return wrap_new_object(obj, repo);
+}
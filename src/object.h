@@ -38,5 +38,7 @@ PyObject* Object_get_hex(Object *self);
 PyObject* Object_get_type(Object *self);
 PyObject* Object_read_raw(Object *self);
 PyObject* wrap_object(git_object *c_object, Repository *repo);
+PyObject* wrap_new_object(git_object *c_object, Repository *repo);
+PyObject* lookup_object(Repository *repo, const git_oid *oid, git_otype type);
 
 #endif
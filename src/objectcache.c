@@ -0,0 +1,394 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A bounded LRU of object wrappers, hung off every Repository.  The entries
+ * in the LRU hold a strong reference to their wrapper, so the most recently
+ * used objects are reused even when nothing else refers to them.  An entry
+ * evicted from the LRU is kept, with only a weak reference, for as long as
+ * its wrapper is alive elsewhere: looking it up again then returns the same
+ * wrapper and moves it back into the LRU.  Dead weak entries are dropped
+ * when they are looked up, or by a sweep once they pile up.  All the
+ * functions here must be called with the GIL held.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include <git2.h>
+#include "objectcache.h"
+
+#define MIN_BUCKETS 16
+
+static size_t
+oid_hash(const git_oid *oid)
+{
+    size_t hash;
+
+    /* The oid is a SHA-1, its leading bytes are as good as any hash */
+    memcpy(&hash, oid->id, sizeof(hash));
+    return hash;
+}
+
+static ObjectCacheEntry **
+find_slot(ObjectCache *cache, const git_oid *oid)
+{
+    ObjectCacheEntry **slot;
+
+    slot = &cache->buckets[oid_hash(oid) & (cache->nbuckets - 1)];
+    while (*slot != NULL && git_oid_cmp(&(*slot)->oid, oid) != 0)
+        slot = &(*slot)->chain;
+
+    return slot;
+}
+
+static void
+lru_unlink(ObjectCache *cache, ObjectCacheEntry *entry)
+{
+    if (entry->prev)
+        entry->prev->next = entry->next;
+    else
+        cache->head = entry->next;
+
+    if (entry->next)
+        entry->next->prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+}
+
+static void
+lru_push_front(ObjectCache *cache, ObjectCacheEntry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head)
+        cache->head->prev = entry;
+    else
+        cache->tail = entry;
+    cache->head = entry;
+}
+
+/*
+ * The references dropped while the cache is being changed, released by
+ * garbage_release() once it is consistent again: releasing a wrapper may
+ * run arbitrary code.  Each change drops at most two entries' worth.
+ */
+typedef struct {
+    PyObject *refs[4];
+    int n;
+} Garbage;
+
+static void
+garbage_add(Garbage *garbage, PyObject *ref)
+{
+    if (ref != NULL)
+        garbage->refs[garbage->n++] = ref;
+}
+
+static void
+garbage_release(Garbage *garbage)
+{
+    while (garbage->n > 0)
+        Py_DECREF(garbage->refs[--garbage->n]);
+}
+
+/* Unlinks and frees a weak entry or, with in_lru, an entry of the LRU */
+static void
+remove_entry(ObjectCache *cache, ObjectCacheEntry **slot, int in_lru,
+             Garbage *garbage)
+{
+    ObjectCacheEntry *entry = *slot;
+
+    *slot = entry->chain;
+    if (in_lru) {
+        lru_unlink(cache, entry);
+        cache->size--;
+    } else {
+        cache->nweak--;
+    }
+
+    garbage_add(garbage, entry->obj);
+    garbage_add(garbage, entry->ref);
+    free(entry);
+}
+
+/* Drops the dead weak entries, in time proportional to the cache */
+static void
+sweep(ObjectCache *cache)
+{
+    ObjectCacheEntry **slot;
+    Garbage garbage = {{NULL}, 0};
+    size_t i;
+
+    for (i = 0; i < cache->nbuckets; i++) {
+        slot = &cache->buckets[i];
+        while (*slot != NULL) {
+            if ((*slot)->obj == NULL &&
+                PyWeakref_GET_OBJECT((*slot)->ref) == Py_None) {
+                /* A dead weak reference runs no code when released */
+                remove_entry(cache, slot, 0, &garbage);
+                garbage_release(&garbage);
+            } else {
+                slot = &(*slot)->chain;
+            }
+        }
+    }
+
+    /* Sweep again once the weak entries have doubled */
+    cache->sweep_at = cache->nweak * 2;
+    if (cache->sweep_at < cache->capacity)
+        cache->sweep_at = cache->capacity;
+}
+
+/* Moves the least recently used entry out of the LRU: it stays as a weak
+ * entry if its wrapper is referred to from elsewhere. */
+static void
+evict_one(ObjectCache *cache, Garbage *garbage)
+{
+    ObjectCacheEntry *entry = cache->tail;
+
+    if (Py_REFCNT(entry->obj) == 1) {
+        remove_entry(cache, find_slot(cache, &entry->oid), 1, garbage);
+        return;
+    }
+
+    lru_unlink(cache, entry);
+    cache->size--;
+    garbage_add(garbage, entry->obj);
+    entry->obj = NULL;
+    cache->nweak++;
+}
+
+void
+ObjectCache_init(ObjectCache *cache)
+{
+    memset(cache, 0, sizeof(ObjectCache));
+}
+
+int
+ObjectCache_resize(ObjectCache *cache, size_t capacity)
+{
+    ObjectCacheEntry **buckets, *entry, *chain;
+    Garbage garbage = {{NULL}, 0};
+    size_t nbuckets, i, j;
+
+    if (capacity == 0) {
+        ObjectCache_free(cache);
+        return 0;
+    }
+
+    /* Keep the load factor of the LRU at or below one */
+    nbuckets = MIN_BUCKETS;
+    while (nbuckets < capacity)
+        nbuckets <<= 1;
+
+    buckets = calloc(nbuckets, sizeof(ObjectCacheEntry *));
+    if (buckets == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    for (i = 0; i < cache->nbuckets; i++) {
+        for (entry = cache->buckets[i]; entry != NULL; entry = chain) {
+            chain = entry->chain;
+            j = oid_hash(&entry->oid) & (nbuckets - 1);
+            entry->chain = buckets[j];
+            buckets[j] = entry;
+        }
+    }
+
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->nbuckets = nbuckets;
+    cache->capacity = capacity;
+    if (cache->sweep_at < capacity)
+        cache->sweep_at = capacity;
+
+    while (cache->size > capacity) {
+        evict_one(cache, &garbage);
+        garbage_release(&garbage);
+    }
+    if (cache->nweak > cache->sweep_at)
+        sweep(cache);
+
+    return 0;
+}
+
+/* Returns a new reference to the cached wrapper, or NULL (without an
+ * exception set) on a miss. */
+PyObject *
+ObjectCache_get(ObjectCache *cache, const git_oid *oid)
+{
+    ObjectCacheEntry **slot, *entry;
+    Garbage garbage = {{NULL}, 0};
+    PyObject *obj;
+
+    if (cache->capacity == 0)
+        return NULL;
+
+    slot = find_slot(cache, oid);
+    entry = *slot;
+    if (entry == NULL) {
+        cache->misses++;
+        return NULL;
+    }
+
+    if (entry->obj != NULL) {
+        obj = entry->obj;
+        if (entry != cache->head) {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+        }
+    } else {
+        obj = PyWeakref_GET_OBJECT(entry->ref);
+        if (obj == Py_None) {
+            /* The wrapper is gone */
+            remove_entry(cache, slot, 0, &garbage);
+            garbage_release(&garbage);
+            cache->misses++;
+            return NULL;
+        }
+
+        /* Still alive, back into the LRU */
+        Py_INCREF(obj);
+        entry->obj = obj;
+        cache->nweak--;
+        lru_push_front(cache, entry);
+        cache->size++;
+        if (cache->size > cache->capacity)
+            evict_one(cache, &garbage);
+    }
+
+    cache->hits++;
+    Py_INCREF(obj);
+    garbage_release(&garbage);
+    return obj;
+}
+
+int
+ObjectCache_put(ObjectCache *cache, const git_oid *oid, PyObject *obj)
+{
+    ObjectCacheEntry **slot, *entry;
+    Garbage garbage = {{NULL}, 0};
+    PyObject *ref;
+
+    if (cache->capacity == 0)
+        return 0;
+
+    ref = PyWeakref_NewRef(obj, NULL);
+    if (ref == NULL)
+        return -1;
+
+    slot = find_slot(cache, oid);
+    entry = *slot;
+    if (entry != NULL) {
+        /* A weak entry, or another thread got there first while the GIL
+         * was released */
+        garbage_add(&garbage, entry->ref);
+        if (entry->obj != NULL) {
+            garbage_add(&garbage, entry->obj);
+            lru_unlink(cache, entry);
+        } else {
+            cache->nweak--;
+            cache->size++;
+        }
+    } else {
+        entry = malloc(sizeof(ObjectCacheEntry));
+        if (entry == NULL) {
+            Py_DECREF(ref);
+            PyErr_NoMemory();
+            return -1;
+        }
+        git_oid_cpy(&entry->oid, oid);
+        entry->chain = NULL;
+        *slot = entry;
+        cache->size++;
+    }
+
+    Py_INCREF(obj);
+    entry->obj = obj;
+    entry->ref = ref;
+    lru_push_front(cache, entry);
+    if (cache->size > cache->capacity)
+        evict_one(cache, &garbage);
+    garbage_release(&garbage);
+
+    if (cache->nweak > cache->sweep_at)
+        sweep(cache);
+    return 0;
+}
+
+void
+ObjectCache_clear(ObjectCache *cache)
+{
+    ObjectCacheEntry *entry, *next, *list = NULL;
+    size_t i;
+
+    /* Detach everything first: releasing a wrapper may run arbitrary code */
+    for (i = 0; i < cache->nbuckets; i++) {
+        for (entry = cache->buckets[i]; entry != NULL; entry = next) {
+            next = entry->chain;
+            entry->next = list;
+            list = entry;
+        }
+    }
+    cache->head = cache->tail = NULL;
+    cache->size = 0;
+    cache->nweak = 0;
+    if (cache->buckets)
+        memset(cache->buckets, 0, cache->nbuckets * sizeof(ObjectCacheEntry *));
+
+    while (list != NULL) {
+        next = list->next;
+        Py_XDECREF(list->obj);
+        Py_DECREF(list->ref);
+        free(list);
+        list = next;
+    }
+}
+
+void
+ObjectCache_free(ObjectCache *cache)
+{
+    ObjectCache_clear(cache);
+    free(cache->buckets);
+    cache->buckets = NULL;
+    cache->nbuckets = 0;
+    cache->capacity = 0;
+    cache->sweep_at = 0;
+}
+
+int
+ObjectCache_traverse(ObjectCache *cache, visitproc visit, void *arg)
+{
+    ObjectCacheEntry *entry;
+
+    for (entry = cache->head; entry != NULL; entry = entry->next)
+        Py_VISIT(entry->obj);
+
+    return 0;
+}
@@ -0,0 +1,1073 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <stdio.h>
+#include <string.h>
+#include <zlib.h>
+#include "error.h"
+#include "utils.h"
+#include "oid.h"
+#include "repository.h"
+#include "odb.h"
+
+extern PyTypeObject OdbObjectType;
+extern PyTypeObject OdbReaderType;
+extern PyTypeObject OdbIterType;
+
+
+PyDoc_STRVAR(OdbObject_id__doc__, "The object id, an instance of the Oid type.");
+
+PyObject *
+OdbObject_id__get__(OdbObject *self)
+{
+    return git_oid_to_python(git_odb_object_id(self->obj));
+}
+
+
+PyDoc_STRVAR(OdbObject_type__doc__,
+    "One of the GIT_OBJ_COMMIT, GIT_OBJ_TREE, GIT_OBJ_BLOB or GIT_OBJ_TAG\n"
+    "constants.");
+
+PyObject *
+OdbObject_type__get__(OdbObject *self)
+{
+    return PyLong_FromLong(git_odb_object_type(self->obj));
+}
+
+
+PyDoc_STRVAR(OdbObject_size__doc__, "Size of the object's data in bytes.");
+
+PyObject *
+OdbObject_size__get__(OdbObject *self)
+{
+    return PyLong_FromSize_t(git_odb_object_size(self->obj));
+}
+
+
+void
+OdbObject_dealloc(OdbObject *self)
+{
+    git_odb_object_free(self->obj);
+    PyObject_Del(self);
+}
+
+
+static int
+OdbObject_getbuffer(OdbObject *self, Py_buffer *view, int flags)
+{
+    return PyBuffer_FillInfo(view, (PyObject *) self,
+                             (void *) git_odb_object_data(self->obj),
+                             git_odb_object_size(self->obj), 1, flags);
+}
+
+#if PY_MAJOR_VERSION == 2
+
+static Py_ssize_t
+OdbObject_getreadbuffer(OdbObject *self, Py_ssize_t index, const void **ptr)
+{
+    if (index != 0) {
+        PyErr_SetString(PyExc_SystemError,
+                        "accessing non-existent object segment");
+        return -1;
+    }
+    *ptr = git_odb_object_data(self->obj);
+    return git_odb_object_size(self->obj);
+}
+
+static Py_ssize_t
+OdbObject_getsegcount(OdbObject *self, Py_ssize_t *lenp)
+{
+    if (lenp)
+        *lenp = git_odb_object_size(self->obj);
+
+    return 1;
+}
+
+static PyBufferProcs OdbObject_as_buffer = {
+    (readbufferproc)OdbObject_getreadbuffer,
+    NULL,                       /* bf_getwritebuffer */
+    (segcountproc)OdbObject_getsegcount,
+    NULL,                       /* charbufferproc */
+    (getbufferproc)OdbObject_getbuffer,
+};
+
+#else
+
+static PyBufferProcs OdbObject_as_buffer = {
+    (getbufferproc)OdbObject_getbuffer,
+};
+
+#endif  /* python 2 vs python 3 buffers */
+
+PyGetSetDef OdbObject_getseters[] = {
+    GETTER(OdbObject, id),
+    GETTER(OdbObject, type),
+    GETTER(OdbObject, size),
+    {NULL}
+};
+
+
+PyDoc_STRVAR(OdbObject__doc__, "Raw object, as read from the object database.\n"
+  "\n"
+  "OdbObjects implement the buffer interface, the data stays owned by\n"
+  "libgit2 and is reachable via `memoryview(obj)` without making a copy."
+);
+
+PyTypeObject OdbObjectType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.OdbObject",                       /* tp_name           */
+    sizeof(OdbObject),                         /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)OdbObject_dealloc,             /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    &OdbObject_as_buffer,                      /* tp_as_buffer      */
+#if PY_MAJOR_VERSION == 2
+    Py_TPFLAGS_DEFAULT |                       /* tp_flags          */
+    Py_TPFLAGS_HAVE_GETCHARBUFFER |
+    Py_TPFLAGS_HAVE_NEWBUFFER,
+#else
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+#endif
+    OdbObject__doc__,                          /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    0,                                         /* tp_iter           */
+    0,                                         /* tp_iternext       */
+    0,                                         /* tp_methods        */
+    0,                                         /* tp_members        */
+    OdbObject_getseters,                       /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
+
+
+PyObject *
+wrap_odb_object(git_odb_object *obj)
+{
+    OdbObject *py_obj;
+
+    py_obj = PyObject_New(OdbObject, &OdbObjectType);
+    if (py_obj == NULL) {
+        git_odb_object_free(obj);
+        return NULL;
+    }
+
+    py_obj->obj = obj;
+    return (PyObject *)py_obj;
+}
+
+
+/*
+ * Loose objects.  libgit2 can not stream them (nor packed ones), so they are
+ * inflated here as they are read: the file holds a zlib stream of a
+ * "<type> <size>\0" header followed by the data.  This does not need the
+ * GIL, errors are reported libgit2 style.  Only the objects directory of
+ * the repository itself is looked at, the object is found through libgit2
+ * otherwise (alternates, packs, other backends).  The reader checks the
+ * SHA-1 of the header and data once it reaches the end.
+ */
+
+#define LOOSE_BUFFER_SIZE 16384
+
+struct LooseStream {
+    FILE *file;
+    z_stream zs;
+    size_t left;  /* Data not inflated yet */
+    char header[64];
+    size_t header_len;  /* With the NUL */
+    unsigned char in[LOOSE_BUFFER_SIZE];
+};
+
+static void
+loose_free(LooseStream *loose)
+{
+    if (loose == NULL)
+        return;
+
+    inflateEnd(&loose->zs);
+    fclose(loose->file);
+    free(loose);
+}
+
+/* Inflates up to len bytes into buffer, returns how many */
+static int
+loose_inflate(size_t *out, LooseStream *loose, unsigned char *buffer,
+              size_t len)
+{
+    z_stream *zs = &loose->zs;
+    size_t n;
+    int status;
+
+    if (len > UINT_MAX)
+        len = UINT_MAX;
+    zs->next_out = buffer;
+    zs->avail_out = (uInt)len;
+
+    while (zs->avail_out > 0) {
+        if (zs->avail_in == 0) {
+            n = fread(loose->in, 1, LOOSE_BUFFER_SIZE, loose->file);
+            if (n == 0) {
+                giterr_set_str(GITERR_ODB, "truncated loose object");
+                return GIT_ERROR;
+            }
+            zs->next_in = loose->in;
+            zs->avail_in = (uInt)n;
+        }
+
+        status = inflate(zs, Z_NO_FLUSH);
+        if (status == Z_STREAM_END)
+            break;
+        if (status != Z_OK) {
+            giterr_set_str(GITERR_ZLIB, "failed to inflate loose object");
+            return GIT_ERROR;
+        }
+    }
+
+    *out = len - zs->avail_out;
+    return 0;
+}
+
+/*
+ * Opens the loose object file of oid and reads its header.  Returns
+ * GIT_ENOTFOUND, without setting an error, when it is not a loose object of
+ * the repository.
+ */
+static int
+loose_open(LooseStream **out, git_repository *repo, const git_oid *oid)
+{
+    LooseStream *loose;
+    const char *repo_path = git_repository_path(repo);
+    char *path, hex[GIT_OID_HEXSZ + 1], *header;
+    unsigned long long size;
+    size_t i, n;
+    int err;
+
+    git_oid_fmt(hex, oid);
+    hex[GIT_OID_HEXSZ] = '\0';
+
+    path = malloc(strlen(repo_path) + sizeof("objects/xx/") + GIT_OID_HEXSZ);
+    if (path == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+    sprintf(path, "%sobjects/%.2s/%s", repo_path, hex, hex + 2);
+
+    loose = calloc(1, sizeof(LooseStream));
+    if (loose == NULL) {
+        free(path);
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+
+    loose->file = fopen(path, "rb");
+    free(path);
+    if (loose->file == NULL) {
+        free(loose);
+        return GIT_ENOTFOUND;
+    }
+
+    if (inflateInit(&loose->zs) != Z_OK) {
+        fclose(loose->file);
+        free(loose);
+        giterr_set_str(GITERR_ZLIB, "failed to initialize zlib");
+        return GIT_ERROR;
+    }
+
+    /* The header, one byte at a time not to inflate any of the data */
+    header = loose->header;
+    for (i = 0; i < sizeof(loose->header); i++) {
+        err = loose_inflate(&n, loose, (unsigned char *)&header[i], 1);
+        if (err < 0)
+            goto error;
+        if (n == 0 || header[i] == '\0')
+            break;
+    }
+
+    if (i == sizeof(loose->header) || n == 0 ||
+        sscanf(header, "%*[a-z] %llu", &size) != 1) {
+        giterr_set_str(GITERR_ODB, "corrupted loose object header");
+        err = GIT_ERROR;
+        goto error;
+    }
+
+    loose->left = (size_t)size;
+    loose->header_len = i + 1;
+    *out = loose;
+    return 0;
+
+error:
+    loose_free(loose);
+    return err;
+}
+
+static int
+loose_read(size_t *out, LooseStream *loose, char *buffer, size_t len)
+{
+    int err;
+
+    if (len > loose->left)
+        len = loose->left;
+    if (len == 0) {
+        *out = 0;
+        return 0;
+    }
+
+    err = loose_inflate(out, loose, (unsigned char *)buffer, len);
+    if (err < 0)
+        return err;
+    if (*out == 0) {
+        giterr_set_str(GITERR_ODB, "truncated loose object");
+        return GIT_ERROR;
+    }
+
+    loose->left -= *out;
+    return 0;
+}
+
+
+/* Feeds what was read of a loose object to its hash, and compares the
+ * hash to the oid at the end.  Needs the GIL. */
+static int
+OdbReader_check_loose(OdbReader *self, const char *buffer, size_t len)
+{
+    PyObject *py_data, *py_digest;
+    int ok;
+
+    if (self->hash == NULL)
+        return 0;
+
+    if (len > 0) {
+        py_data = PyBytes_FromStringAndSize(buffer, len);
+        if (py_data == NULL)
+            return -1;
+        py_digest = PyObject_CallMethod(self->hash, "update", "O", py_data);
+        Py_DECREF(py_data);
+        if (py_digest == NULL)
+            return -1;
+        Py_DECREF(py_digest);
+    }
+
+    if (self->loose->left > 0)
+        return 0;
+
+    py_digest = PyObject_CallMethod(self->hash, "digest", NULL);
+    if (py_digest == NULL)
+        return -1;
+    ok = PyBytes_GET_SIZE(py_digest) == GIT_OID_RAWSZ &&
+         memcmp(PyBytes_AS_STRING(py_digest), self->oid.id,
+                GIT_OID_RAWSZ) == 0;
+    Py_DECREF(py_digest);
+    if (!ok) {
+        giterr_set_str(GITERR_ODB, "object hash mismatch");
+        Error_set(GIT_ERROR);
+        return -1;
+    }
+
+    Py_CLEAR(self->hash);
+    return 0;
+}
+
+
+#define CHECK_READER(self)\
+    if (self->closed) {\
+        PyErr_SetString(PyExc_ValueError, "I/O operation on closed reader");\
+        return NULL;\
+    }
+
+/*
+ * Reads up to len bytes into buffer.  Returns the number of bytes read, 0 at
+ * the end of the object, or -1 with an exception set.
+ */
+static Py_ssize_t
+OdbReader_read_into(OdbReader *self, char *buffer, size_t len)
+{
+    size_t left;
+    int err;
+
+    if (self->loose != NULL) {
+        Py_BEGIN_ALLOW_THREADS
+        err = loose_read(&left, self->loose, buffer, len);
+        Py_END_ALLOW_THREADS
+        if (err < 0) {
+            Error_set(err);
+            return -1;
+        }
+        if (OdbReader_check_loose(self, buffer, left) < 0)
+            return -1;
+
+        self->offset += left;
+        return left;
+    }
+
+    if (self->stream == NULL) {
+        left = self->view.len - self->offset;
+        if (len > left)
+            len = left;
+        memcpy(buffer, (char *)self->view.buf + self->offset, len);
+        self->offset += len;
+        return len;
+    }
+
+    if (len > INT_MAX)
+        len = INT_MAX;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_odb_stream_read(self->stream, buffer, len);
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        return -1;
+    }
+
+    self->offset += err;
+    return err;
+}
+
+
+PyDoc_STRVAR(OdbReader_read__doc__,
+  "read([size]) -> bytes\n"
+  "\n"
+  "Read at most size bytes, or up to the end of the object if size is\n"
+  "negative or omitted. Returns an empty string at the end of the object.");
+
+PyObject *
+OdbReader_read(OdbReader *self, PyObject *args)
+{
+    Py_ssize_t size = -1, capacity, total = 0, n;
+    PyObject *result;
+
+    if (!PyArg_ParseTuple(args, "|n", &size))
+        return NULL;
+
+    CHECK_READER(self);
+
+    /* No more than is left, when that is known */
+    if (self->loose != NULL)
+        capacity = self->loose->left;
+    else if (self->stream == NULL)
+        capacity = self->view.len - self->offset;
+    else
+        capacity = self->chunk_size;
+    if (size >= 0 && size < capacity)
+        capacity = size;
+
+    result = PyBytes_FromStringAndSize(NULL, capacity);
+    if (result == NULL)
+        return NULL;
+
+    while (total < capacity) {
+        n = OdbReader_read_into(self, PyBytes_AS_STRING(result) + total,
+                                capacity - total);
+        if (n < 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        if (n == 0)
+            break;
+        total += n;
+
+        /* Reading a stream, grow the result up to size */
+        if (self->stream != NULL && total == capacity && total != size) {
+            capacity *= 2;
+            if (size >= 0 && capacity > size)
+                capacity = size;
+            if (_PyBytes_Resize(&result, capacity) < 0)
+                return NULL;
+        }
+    }
+
+    /* An empty object is checked without reading anything */
+    if (self->loose != NULL && OdbReader_check_loose(self, NULL, 0) < 0) {
+        Py_DECREF(result);
+        return NULL;
+    }
+
+    if (total != capacity && _PyBytes_Resize(&result, total) < 0)
+        return NULL;
+
+    return result;
+}
+
+
+PyDoc_STRVAR(OdbReader_readinto__doc__,
+  "readinto(buffer) -> int\n"
+  "\n"
+  "Read bytes into a pre-allocated, writable buffer and return the number\n"
+  "of bytes read, 0 at the end of the object.");
+
+PyObject *
+OdbReader_readinto(OdbReader *self, PyObject *py_buffer)
+{
+    Py_buffer view;
+    Py_ssize_t n;
+
+    CHECK_READER(self);
+
+    if (PyObject_GetBuffer(py_buffer, &view, PyBUF_WRITABLE) < 0)
+        return NULL;
+
+    n = OdbReader_read_into(self, view.buf, view.len);
+    PyBuffer_Release(&view);
+    if (n < 0)
+        return NULL;
+
+    return PyLong_FromSsize_t(n);
+}
+
+
+PyDoc_STRVAR(OdbReader_readable__doc__,
+  "readable() -> bool\n"
+  "\n"
+  "Always True, for compatibility with io.BufferedReader.");
+
+PyObject *
+OdbReader_readable(OdbReader *self)
+{
+    CHECK_READER(self);
+    Py_RETURN_TRUE;
+}
+
+
+static void
+OdbReader_release(OdbReader *self)
+{
+    if (self->closed)
+        return;
+
+    if (self->stream != NULL)
+        git_odb_stream_free(self->stream);
+    else if (self->loose != NULL)
+        loose_free(self->loose);
+    else
+        PyBuffer_Release(&self->view);
+    git_odb_free(self->odb);
+    Py_CLEAR(self->hash);
+
+    self->stream = NULL;
+    self->loose = NULL;
+    self->odb = NULL;
+    self->closed = 1;
+}
+
+PyDoc_STRVAR(OdbReader_close__doc__,
+  "close()\n"
+  "\n"
+  "Release the object. Further reads raise ValueError.");
+
+PyObject *
+OdbReader_close(OdbReader *self)
+{
+    OdbReader_release(self);
+    Py_RETURN_NONE;
+}
+
+
+PyDoc_STRVAR(OdbReader_closed__doc__, "True once the reader is closed.");
+
+PyObject *
+OdbReader_closed__get__(OdbReader *self)
+{
+    return PyBool_FromLong(self->closed);
+}
+
+
+PyObject *
+OdbReader_iternext(OdbReader *self)
+{
+    PyObject *chunk, *args;
+
+    args = Py_BuildValue("(n)", self->chunk_size);
+    if (args == NULL)
+        return NULL;
+
+    chunk = OdbReader_read(self, args);
+    Py_DECREF(args);
+    if (chunk == NULL || PyBytes_Size(chunk) > 0)
+        return chunk;
+
+    Py_DECREF(chunk);
+    return NULL;
+}
+
+void
+OdbReader_dealloc(OdbReader *self)
+{
+    OdbReader_release(self);
+    PyObject_Del(self);
+}
+
+
+PyMethodDef OdbReader_methods[] = {
+    METHOD(OdbReader, read, METH_VARARGS),
+    METHOD(OdbReader, readinto, METH_O),
+    METHOD(OdbReader, readable, METH_NOARGS),
+    METHOD(OdbReader, close, METH_NOARGS),
+    {NULL}
+};
+
+PyGetSetDef OdbReader_getseters[] = {
+    GETTER(OdbReader, closed),
+    {NULL}
+};
+
+
+PyDoc_STRVAR(OdbReader__doc__, "File-like reader over the data of an object.\n"
+  "\n"
+  "Iterating over a reader yields the data in chunks of fixed size.");
+
+PyTypeObject OdbReaderType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.OdbReader",                       /* tp_name           */
+    sizeof(OdbReader),                         /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)OdbReader_dealloc,             /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    OdbReader__doc__,                          /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    PyObject_SelfIter,                         /* tp_iter           */
+    (iternextfunc)OdbReader_iternext,          /* tp_iternext       */
+    OdbReader_methods,                         /* tp_methods        */
+    0,                                         /* tp_members        */
+    OdbReader_getseters,                       /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
+
+
+static OdbReader *
+new_odb_reader(Py_ssize_t chunk_size)
+{
+    OdbReader *reader;
+
+    reader = PyObject_New(OdbReader, &OdbReaderType);
+    if (reader == NULL)
+        return NULL;
+
+    reader->odb = NULL;
+    reader->stream = NULL;
+    reader->loose = NULL;
+    reader->hash = NULL;
+    reader->offset = 0;
+    reader->chunk_size = chunk_size;
+    reader->closed = 1;
+    return reader;
+}
+
+static int
+check_chunk_size(Py_ssize_t chunk_size)
+{
+    if (chunk_size <= 0) {
+        PyErr_SetString(PyExc_ValueError, "chunk_size must be positive");
+        return -1;
+    }
+
+    return 0;
+}
+
+PyObject *
+wrap_odb_reader_from_buffer(PyObject *owner, Py_ssize_t chunk_size)
+{
+    OdbReader *reader;
+
+    if (check_chunk_size(chunk_size) < 0)
+        return NULL;
+
+    reader = new_odb_reader(chunk_size);
+    if (reader == NULL)
+        return NULL;
+
+    if (PyObject_GetBuffer(owner, &reader->view, PyBUF_SIMPLE) < 0) {
+        Py_DECREF(reader);
+        return NULL;
+    }
+
+    reader->closed = 0;
+    return (PyObject *)reader;
+}
+
+/* A hashlib.sha1() fed with the header of the loose object */
+static PyObject *
+new_loose_hash(LooseStream *loose)
+{
+    PyObject *module, *py_header, *hash;
+
+    module = PyImport_ImportModule("hashlib");
+    if (module == NULL)
+        return NULL;
+
+    py_header = PyBytes_FromStringAndSize(loose->header, loose->header_len);
+    if (py_header == NULL) {
+        Py_DECREF(module);
+        return NULL;
+    }
+
+    hash = PyObject_CallMethod(module, "sha1", "O", py_header);
+    Py_DECREF(py_header);
+    Py_DECREF(module);
+    return hash;
+}
+
+/*
+ * Streams the object from the odb when a backend supports it.  The loose
+ * and pack backends of libgit2 do not: loose objects are then inflated as
+ * they are read, and the others (packed objects) are read whole, once and
+ * without a copy, and served from memory.
+ */
+PyObject *
+wrap_odb_reader(Repository *repo, const git_oid *oid, Py_ssize_t chunk_size)
+{
+    OdbReader *reader;
+    git_odb *odb;
+    git_odb_stream *stream;
+    git_odb_object *obj;
+    LooseStream *loose;
+    PyObject *py_obj;
+    int err;
+
+    if (check_chunk_size(chunk_size) < 0)
+        return NULL;
+
+    err = git_repository_odb(&odb, repo->repo);
+    if (err < 0)
+        return Error_set(err);
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_odb_open_rstream(&stream, odb, oid);
+    Py_END_ALLOW_THREADS
+    if (err == 0) {
+        reader = new_odb_reader(chunk_size);
+        if (reader == NULL) {
+            git_odb_stream_free(stream);
+            git_odb_free(odb);
+            return NULL;
+        }
+
+        reader->odb = odb;
+        reader->stream = stream;
+        reader->closed = 0;
+        return (PyObject *)reader;
+    }
+
+    giterr_clear();
+    git_odb_free(odb);
+
+    Py_BEGIN_ALLOW_THREADS
+    err = loose_open(&loose, repo->repo, oid);
+    Py_END_ALLOW_THREADS
+    if (err == 0) {
+        reader = new_odb_reader(chunk_size);
+        if (reader == NULL) {
+            loose_free(loose);
+            return NULL;
+        }
+
+        reader->loose = loose;
+        reader->closed = 0;
+        git_oid_cpy(&reader->oid, oid);
+        reader->hash = new_loose_hash(loose);
+        if (reader->hash == NULL) {
+            Py_DECREF(reader);
+            return NULL;
+        }
+        return (PyObject *)reader;
+    }
+    if (err != GIT_ENOTFOUND)
+        return Error_set(err);
+
+    obj = Repository_read_raw(repo->repo, oid, GIT_OID_HEXSZ);
+    if (obj == NULL)
+        return NULL;
+
+    py_obj = wrap_odb_object(obj);
+    if (py_obj == NULL)
+        return NULL;
+
+    reader = (OdbReader *)wrap_odb_reader_from_buffer(py_obj, chunk_size);
+    Py_DECREF(py_obj);
+    return (PyObject *)reader;
+}
+
+/*
+ * The object database is walked with git_odb_foreach on a worker thread,
+ * without the GIL.  The worker fills a chunk of oids, hands it over by
+ * releasing chunk_ready, and waits on chunk_taken until the iterator has
+ * copied it out.  Memory use is bounded by the chunk size, and the first
+ * oids are available as soon as the first chunk is full.
+ */
+
+static int
+OdbIter_handoff(OdbIter *self)
+{
+    PyThread_release_lock(self->chunk_ready);
+    PyThread_acquire_lock(self->chunk_taken, WAIT_LOCK);
+    self->chunk_len = 0;
+
+    return self->cancelled ? GIT_EUSER : 0;
+}
+
+static int
+OdbIter_foreach_cb(const git_oid *oid, void *payload)
+{
+    OdbIter *self = (OdbIter *)payload;
+    git_otype type;
+    size_t len;
+    int err;
+
+    if (self->cancelled)
+        return GIT_EUSER;
+
+    if (self->type != GIT_OBJ_ANY) {
+        err = git_odb_read_header(&len, &type, self->odb, oid);
+        if (err < 0)
+            return err;
+        if (type != self->type)
+            return 0;
+    }
+
+    git_oid_cpy(&self->chunk[self->chunk_len++], oid);
+    if (self->chunk_len == ODB_ITER_CHUNK)
+        return OdbIter_handoff(self);
+
+    return 0;
+}
+
+static void
+OdbIter_worker(void *payload)
+{
+    OdbIter *self = (OdbIter *)payload;
+    int err;
+
+    err = git_odb_foreach(self->odb, OdbIter_foreach_cb, self);
+    if (err < 0 && !self->cancelled)
+        Error_save(&self->error, err);
+
+    /* Hand over the last (possibly partial) chunk.  The iterator may be
+     * deallocated as soon as the lock is released. */
+    self->done = 1;
+    PyThread_release_lock(self->chunk_ready);
+}
+
+static int
+OdbIter_next_chunk(OdbIter *self)
+{
+    while (!self->finished) {
+        if (!self->started) {
+            if (PyThread_start_new_thread(OdbIter_worker, self) == -1) {
+                PyErr_SetString(PyExc_RuntimeError, "can't start new thread");
+                return -1;
+            }
+            self->started = 1;
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        PyThread_acquire_lock(self->chunk_ready, WAIT_LOCK);
+        Py_END_ALLOW_THREADS
+
+        memcpy(self->oids, self->chunk, self->chunk_len * sizeof(git_oid));
+        self->i = 0;
+        self->n = self->chunk_len;
+        if (self->done)
+            self->finished = 1;
+        else
+            PyThread_release_lock(self->chunk_taken);
+
+        if (self->n > 0)
+            return 0;
+    }
+
+    if (self->error.err < 0) {
+        Error_set_saved(&self->error);
+        self->error.err = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+PyObject *
+OdbIter_iternext(OdbIter *self)
+{
+    if (self->i == self->n) {
+        if (OdbIter_next_chunk(self) < 0)
+            return NULL;
+        if (self->i == self->n)
+            return NULL;
+    }
+
+    return git_oid_to_python(&self->oids[self->i++]);
+}
+
+void
+OdbIter_dealloc(OdbIter *self)
+{
+    /* Stop the worker, and wait for it to let go of the iterator */
+    if (self->started && !self->finished) {
+        self->cancelled = 1;
+        Py_BEGIN_ALLOW_THREADS
+        for (;;) {
+            PyThread_acquire_lock(self->chunk_ready, WAIT_LOCK);
+            if (self->done)
+                break;
+            PyThread_release_lock(self->chunk_taken);
+        }
+        Py_END_ALLOW_THREADS
+    }
+
+    if (self->chunk_ready != NULL)
+        PyThread_free_lock(self->chunk_ready);
+    if (self->chunk_taken != NULL)
+        PyThread_free_lock(self->chunk_taken);
+    git_odb_free(self->odb);
+    free(self->error.message);
+    Py_CLEAR(self->repo);
+    PyObject_Del(self);
+}
+
+
+PyDoc_STRVAR(OdbIter__doc__, "Object database iterator.");
+
+PyTypeObject OdbIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.OdbIter",                         /* tp_name           */
+    sizeof(OdbIter),                           /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)OdbIter_dealloc,               /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    OdbIter__doc__,                            /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    PyObject_SelfIter,                         /* tp_iter           */
+    (iternextfunc) OdbIter_iternext,           /* tp_iternext       */
+};
+
+
+PyObject *
+wrap_odb_iter(Repository *repo, git_otype type)
+{
+    OdbIter *iter;
+    int err;
+
+    iter = PyObject_New(OdbIter, &OdbIterType);
+    if (iter == NULL)
+        return NULL;
+
+    iter->repo = NULL;
+    iter->odb = NULL;
+    iter->type = type;
+    iter->chunk_ready = NULL;
+    iter->chunk_taken = NULL;
+    iter->chunk_len = 0;
+    iter->i = 0;
+    iter->n = 0;
+    iter->started = 0;
+    iter->finished = 0;
+    iter->done = 0;
+    iter->cancelled = 0;
+    iter->error.err = 0;
+    iter->error.message = NULL;
+
+    err = git_repository_odb(&iter->odb, repo->repo);
+    if (err < 0) {
+        Py_DECREF(iter);
+        return Error_set(err);
+    }
+
+    /* Both locks start out taken: each side waits for the other */
+    iter->chunk_ready = PyThread_allocate_lock();
+    iter->chunk_taken = PyThread_allocate_lock();
+    if (iter->chunk_ready == NULL || iter->chunk_taken == NULL) {
+        Py_DECREF(iter);
+        return PyErr_NoMemory();
+    }
+    PyThread_acquire_lock(iter->chunk_ready, WAIT_LOCK);
+    PyThread_acquire_lock(iter->chunk_taken, WAIT_LOCK);
+
+    Py_INCREF(repo);
+    iter->repo = repo;
+    return (PyObject *)iter;
+}
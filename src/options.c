@@ -156,6 +156,146 @@ option(PyObject *self, PyObject *args)
             Py_RETURN_NONE;
             break;
         }
+
+        case GIT_OPT_GET_MWINDOW_MAPPED_LIMIT:
+        {
+            size_t limit;
+
+            error = git_libgit2_opts(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT, &limit);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            return PyLong_FromSize_t(limit);
+
+            break;
+        }
+
+        case GIT_OPT_SET_MWINDOW_MAPPED_LIMIT:
+        {
+            size_t limit;
+            PyObject *py_limit;
+
+            py_limit = PyTuple_GetItem(args, 1);
+            if (!py_limit)
+                return NULL;
+
+            if (!PyLong_Check(py_limit))
+                goto on_non_integer;
+
+            limit = PyLong_AsSize_t(py_limit);
+            if (limit == (size_t)-1 && PyErr_Occurred())
+                return NULL;
+
+            error = git_libgit2_opts(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, limit);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            Py_RETURN_NONE;
+            break;
+        }
+
+        case GIT_OPT_SET_CACHE_OBJECT_LIMIT:
+        {
+            size_t limit;
+            int type;
+            PyObject *py_type, *py_limit;
+
+            py_type = PyTuple_GetItem(args, 1);
+            if (!py_type)
+                return NULL;
+
+            py_limit = PyTuple_GetItem(args, 2);
+            if (!py_limit)
+                return NULL;
+
+            if (!PyLong_Check(py_type) || !PyLong_Check(py_limit))
+                goto on_non_integer;
+
+            type = PyLong_AsLong(py_type);
+            limit = PyLong_AsSize_t(py_limit);
+            if (limit == (size_t)-1 && PyErr_Occurred())
+                return NULL;
+
+            error = git_libgit2_opts(GIT_OPT_SET_CACHE_OBJECT_LIMIT,
+                                     (git_otype)type, limit);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            Py_RETURN_NONE;
+            break;
+        }
+
+        case GIT_OPT_SET_CACHE_MAX_SIZE:
+        {
+            Py_ssize_t size;
+            PyObject *py_size;
+
+            py_size = PyTuple_GetItem(args, 1);
+            if (!py_size)
+                return NULL;
+
+            if (!PyLong_Check(py_size))
+                goto on_non_integer;
+
+            size = PyNumber_AsSsize_t(py_size, PyExc_OverflowError);
+            if (size == -1 && PyErr_Occurred())
+                return NULL;
+
+            error = git_libgit2_opts(GIT_OPT_SET_CACHE_MAX_SIZE, (ssize_t)size);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            Py_RETURN_NONE;
+            break;
+        }
+
+        case GIT_OPT_ENABLE_CACHING:
+        {
+            int enable;
+            PyObject *py_enable;
+
+            py_enable = PyTuple_GetItem(args, 1);
+            if (!py_enable)
+                return NULL;
+
+            enable = PyObject_IsTrue(py_enable);
+            if (enable == -1)
+                return NULL;
+
+            error = git_libgit2_opts(GIT_OPT_ENABLE_CACHING, enable);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            Py_RETURN_NONE;
+            break;
+        }
+
+        case GIT_OPT_GET_CACHED_MEMORY:
+        {
+            ssize_t current, allowed;
+
+            error = git_libgit2_opts(GIT_OPT_GET_CACHED_MEMORY,
+                                     &current, &allowed);
+            if (error < 0) {
+                Error_set(error);
+                return NULL;
+            }
+
+            return Py_BuildValue("nn", (Py_ssize_t)current,
+                                 (Py_ssize_t)allowed);
+
+            break;
+        }
     }
 
     PyErr_SetString(PyExc_ValueError, "unknown/unsupported option value");
@@ -43,7 +43,19 @@ PyDoc_STRVAR(option__doc__,
   "  (GIT_OPT_GET_MWINDOW_SIZE)\n"
   "  Get the maximum mmap window size\n"
   "  (GIT_OPT_SET_MWINDOW_SIZE, size)\n"
-  "  Set the maximum mmap window size\n");
+  "  Set the maximum mmap window size\n"
+  "  (GIT_OPT_GET_MWINDOW_MAPPED_LIMIT)\n"
+  "  Get the maximum memory that will be mapped in total\n"
+  "  (GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, size)\n"
+  "  Set the maximum memory that will be mapped in total\n"
+  "  (GIT_OPT_SET_CACHE_OBJECT_LIMIT, type, size)\n"
+  "  Set the largest object of the given type that will be cached\n"
+  "  (GIT_OPT_SET_CACHE_MAX_SIZE, size)\n"
+  "  Set the maximum memory used by the object cache\n"
+  "  (GIT_OPT_ENABLE_CACHING, enabled)\n"
+  "  Enable or disable the object cache\n"
+  "  (GIT_OPT_GET_CACHED_MEMORY)\n"
+  "  Get the (current, allowed) memory used by the object cache\n");
 
 
 PyObject *option(PyObject *self, PyObject *args);
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include <git2/sys/odb_backend.h>
+#include <git2/sys/mempack.h>
+#include "error.h"
+#include "utils.h"
+#include "oid.h"
+#include "repository.h"
+#include "packwriter.h"
+
+extern PyTypeObject PackWriterType;
+
+
+/*
+ * Objects are written to an in-memory backend, added with the highest
+ * priority to the odb of a private handle on the repository.  On commit
+ * they are packed by git_packbuilder straight into objects/pack; the pack
+ * index is written last, so they become visible all at once.
+ */
+
+void
+PackWriter_dealloc(PackWriter *self)
+{
+    /* Frees the mempack backend, and whatever was not committed */
+    git_odb_free(self->odb);
+    git_repository_free(self->pack_repo);
+    free(self->oids);
+    Py_CLEAR(self->repo);
+    PyObject_Del(self);
+}
+
+
+PyDoc_STRVAR(PackWriter_write__doc__,
+    "write(type, data) -> Oid\n"
+    "\n"
+    "Add an object to the pack being built. First arg is the object type,\n"
+    "the second one a buffer with data. Return the Oid of the object, which\n"
+    "is only visible in the repository after commit().");
+
+PyObject *
+PackWriter_write(PackWriter *self, PyObject *args)
+{
+    int err, exists = 0;
+    git_oid oid;
+    int type_id;
+    const char* buffer;
+    Py_ssize_t buflen;
+    git_otype type;
+    git_oid *new_oids;
+
+    if (!PyArg_ParseTuple(args, "Is#", &type_id, &buffer, &buflen))
+        return NULL;
+
+    type = int_to_loose_object_type(type_id);
+    if (type == GIT_OBJ_BAD)
+        return PyErr_Format(PyExc_ValueError, "%d", type_id);
+
+    if (self->n == self->alloc) {
+        self->alloc = self->alloc ? self->alloc * 2 : 64;
+        new_oids = realloc(self->oids, self->alloc * sizeof(git_oid));
+        if (new_oids == NULL)
+            return PyErr_NoMemory();
+        self->oids = new_oids;
+    }
+
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    err = git_odb_hash(&oid, buffer, buflen, type);
+    if (err == 0) {
+        /* Already in the repository, or already written */
+        exists = git_odb_exists(self->odb, &oid);
+        if (!exists)
+            err = git_odb_write(&oid, self->odb, buffer, buflen, type);
+    }
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    if (err < 0)
+        return Error_set(err);
+
+    if (!exists)
+        git_oid_cpy(&self->oids[self->n++], &oid);
+
+    return git_oid_to_python(&oid);
+}
+
+
+PyDoc_STRVAR(PackWriter_commit__doc__,
+    "commit() -> int\n"
+    "\n"
+    "Write the objects added since the last commit into a new pack (and its\n"
+    "index) in the repository, and make them visible. Returns the number of\n"
+    "objects written.");
+
+PyObject *
+PackWriter_commit(PackWriter *self)
+{
+    git_packbuilder *pb = NULL;
+    git_odb *odb;
+    const char *repo_path;
+    char *pack_dir;
+    size_t i, count;
+    int err;
+
+    count = self->n;
+    if (count == 0)
+        return PyLong_FromSize_t(0);
+
+    repo_path = git_repository_path(self->repo->repo);
+    pack_dir = malloc(strlen(repo_path) + sizeof("objects/pack"));
+    if (pack_dir == NULL)
+        return PyErr_NoMemory();
+    strcpy(pack_dir, repo_path);
+    strcat(pack_dir, "objects/pack");
+
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    err = git_packbuilder_new(&pb, self->pack_repo);
+    if (err == 0) {
+        git_packbuilder_set_threads(pb, 0);
+        for (i = 0; i < count && err == 0; i++)
+            err = git_packbuilder_insert(pb, &self->oids[i], NULL);
+    }
+    if (err == 0)
+        err = git_packbuilder_write(pb, pack_dir, 0, NULL, NULL);
+    git_packbuilder_free(pb);
+
+    /* Let both handles see the new pack */
+    if (err == 0)
+        err = git_odb_refresh(self->odb);
+    if (err == 0)
+        err = git_repository_odb(&odb, self->repo->repo);
+    if (err == 0) {
+        err = git_odb_refresh(odb);
+        git_odb_free(odb);
+    }
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    free(pack_dir);
+    if (err < 0)
+        return Error_set(err);
+
+    git_mempack_reset(self->mempack);
+    self->n = 0;
+    return PyLong_FromSize_t(count);
+}
+
+
+PyDoc_STRVAR(PackWriter_rollback__doc__,
+    "rollback()\n"
+    "\n"
+    "Discard the objects added since the last commit.");
+
+PyObject *
+PackWriter_rollback(PackWriter *self)
+{
+    git_mempack_reset(self->mempack);
+    self->n = 0;
+    Py_RETURN_NONE;
+}
+
+
+PyMethodDef PackWriter_methods[] = {
+    METHOD(PackWriter, write, METH_VARARGS),
+    METHOD(PackWriter, commit, METH_NOARGS),
+    METHOD(PackWriter, rollback, METH_NOARGS),
+    {NULL}
+};
+
+
+Py_ssize_t
+PackWriter_len(PackWriter *self)
+{
+    return (Py_ssize_t)self->n;
+}
+
+
+PyMappingMethods PackWriter_as_mapping = {
+    (lenfunc)PackWriter_len,      /* mp_length */
+    0,                            /* mp_subscript */
+    0,                            /* mp_ass_subscript */
+};
+
+
+PyDoc_STRVAR(PackWriter__doc__, "Writes objects into a single pack.\n"
+  "\n"
+  "The length of a PackWriter is the number of objects waiting for\n"
+  "commit().");
+
+PyTypeObject PackWriterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.PackWriter",                      /* tp_name           */
+    sizeof(PackWriter),                        /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)PackWriter_dealloc,            /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    &PackWriter_as_mapping,                    /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    PackWriter__doc__,                         /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    0,                                         /* tp_iter           */
+    0,                                         /* tp_iternext       */
+    PackWriter_methods,                        /* tp_methods        */
+    0,                                         /* tp_members        */
+    0,                                         /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
+
+
+PyObject *
+wrap_pack_writer(Repository *repo)
+{
+    PackWriter *writer;
+    int err;
+
+    writer = PyObject_New(PackWriter, &PackWriterType);
+    if (writer == NULL)
+        return NULL;
+
+    writer->repo = NULL;
+    writer->pack_repo = NULL;
+    writer->odb = NULL;
+    writer->mempack = NULL;
+    writer->oids = NULL;
+    writer->n = 0;
+    writer->alloc = 0;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_repository_open(&writer->pack_repo,
+                              git_repository_path(repo->repo));
+    if (err == 0)
+        err = git_repository_odb(&writer->odb, writer->pack_repo);
+    if (err == 0)
+        err = git_mempack_new(&writer->mempack);
+    if (err == 0) {
+        /* The odb takes ownership of the backend */
+        err = git_odb_add_backend(writer->odb, writer->mempack, 999);
+        if (err < 0)
+            writer->mempack->free(writer->mempack);
+    }
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        Py_DECREF(writer);
+        return NULL;
+    }
+
+    Py_INCREF(repo);
+    writer->repo = repo;
+    return (PyObject *)writer;
+}
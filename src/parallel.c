@@ -0,0 +1,156 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <pythread.h>
+#include "parallel.h"
+
+typedef struct {
+    size_t n;
+    size_t next;                     /* The next index to hand out */
+    int (*fn)(size_t i, void *payload);
+    void *payload;
+    int running;                     /* Threads not finished yet */
+    int failed;
+    SavedError *error;
+    PyThread_type_lock lock;         /* Protects next, running and failed */
+    PyThread_type_lock done;         /* Released by the last thread out */
+} ParallelJob;
+
+static void
+parallel_worker(void *payload)
+{
+    ParallelJob *job = (ParallelJob *)payload;
+    size_t i;
+    int err, last;
+
+    for (;;) {
+        PyThread_acquire_lock(job->lock, WAIT_LOCK);
+        if (job->failed || job->next == job->n) {
+            PyThread_release_lock(job->lock);
+            break;
+        }
+        i = job->next++;
+        PyThread_release_lock(job->lock);
+
+        err = job->fn(i, job->payload);
+        if (err < 0) {
+            PyThread_acquire_lock(job->lock, WAIT_LOCK);
+            if (!job->failed) {
+                job->failed = 1;
+                Error_save(job->error, err);
+            }
+            PyThread_release_lock(job->lock);
+        }
+    }
+
+    PyThread_acquire_lock(job->lock, WAIT_LOCK);
+    last = (--job->running == 0);
+    PyThread_release_lock(job->lock);
+
+    /* The job may be gone as soon as this is released */
+    if (last)
+        PyThread_release_lock(job->done);
+}
+
+int
+parallel_for(size_t n, int n_threads, int (*fn)(size_t i, void *payload),
+             void *payload, SavedError *error)
+{
+    ParallelJob job;
+    int i;
+
+    if (n == 0)
+        return 0;
+
+    if (n_threads < 1)
+        n_threads = 1;
+    if ((size_t)n_threads > n)
+        n_threads = (int)n;
+
+    job.n = n;
+    job.next = 0;
+    job.fn = fn;
+    job.payload = payload;
+    job.running = n_threads;
+    job.failed = 0;
+    job.error = error;
+    job.lock = PyThread_allocate_lock();
+    job.done = PyThread_allocate_lock();
+    if (job.lock == NULL || job.done == NULL) {
+        if (job.lock != NULL)
+            PyThread_free_lock(job.lock);
+        if (job.done != NULL)
+            PyThread_free_lock(job.done);
+        giterr_set_oom();
+        Error_save(error, GIT_ERROR);
+        return GIT_ERROR;
+    }
+    PyThread_acquire_lock(job.done, WAIT_LOCK);
+
+    /* If a thread cannot be started its share goes to the others */
+    for (i = 1; i < n_threads; i++) {
+        if (PyThread_start_new_thread(parallel_worker, &job) == -1) {
+            PyThread_acquire_lock(job.lock, WAIT_LOCK);
+            job.running -= n_threads - i;
+            PyThread_release_lock(job.lock);
+            break;
+        }
+    }
+
+    parallel_worker(&job);
+
+    PyThread_acquire_lock(job.done, WAIT_LOCK);
+    PyThread_release_lock(job.done);
+    PyThread_free_lock(job.done);
+    PyThread_free_lock(job.lock);
+
+    return job.failed ? error->err : 0;
+}
+
+int
+parallel_cpu_count(void)
+{
+    PyObject *module, *py_count;
+    long count = 1;
+
+    module = PyImport_ImportModule("multiprocessing");
+    if (module != NULL) {
+        py_count = PyObject_CallMethod(module, "cpu_count", NULL);
+        if (py_count != NULL) {
+            count = PyLong_AsLong(py_count);
+            Py_DECREF(py_count);
+        }
+        Py_DECREF(module);
+    }
+
+    /* cpu_count() raises NotImplementedError when it cannot tell */
+    PyErr_Clear();
+    return count < 1 ? 1 : (int)count;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDE_pygit2_parallel_h
+#define INCLUDE_pygit2_parallel_h
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <git2.h>
+#include "error.h"
+
+/*
+ * Calls fn(i, payload) for every i in [0, n) on up to n_threads threads,
+ * the calling one included.  Indexes are handed out one at a time from a
+ * shared counter, so a thread that finishes a short task early takes the
+ * next one instead of idling.
+ *
+ * Must be called with the GIL released, and fn must not touch Python.  It
+ * returns libgit2 style: on failure no new task is started, and the first
+ * error is saved into *error, to be raised with Error_set_saved().
+ */
+int parallel_for(size_t n, int n_threads,
+                 int (*fn)(size_t i, void *payload), void *payload,
+                 SavedError *error);
+
+/* The number of CPUs, 1 if unknown.  Needs the GIL. */
+int parallel_cpu_count(void);
+
+#endif
@@ -31,47 +31,71 @@
 #include "diff.h"
 #include "error.h"
 #include "oid.h"
+#include "patch.h"
 #include "types.h"
 #include "utils.h"
 
 extern PyTypeObject DiffHunkType;
 PyTypeObject PatchType;
+PyTypeObject PatchHunksType;
+PyTypeObject PatchLinesType;
 
 
 PyObject *
 wrap_patch(git_patch *patch)
 {
     Patch *py_patch;
-    PyObject *py_hunk;
-    size_t i, hunk_amounts;
 
     if (!patch)
         Py_RETURN_NONE;
 
     py_patch = PyObject_New(Patch, &PatchType);
-    if (py_patch) {
-        py_patch->patch = patch;
-
-        hunk_amounts = git_patch_num_hunks(patch);
-        py_patch->hunks = PyList_New(hunk_amounts);
-        for (i = 0; i < hunk_amounts; ++i) {
-            py_hunk = wrap_diff_hunk(patch, i);
-            if (py_hunk)
-                PyList_SetItem((PyObject*) py_patch->hunks, i, py_hunk);
-        }
+    if (py_patch == NULL) {
+        git_patch_free(patch);
+        return NULL;
     }
 
+    py_patch->patch = patch;
     return (PyObject*) py_patch;
 }
 
 static void
 Patch_dealloc(Patch *self)
 {
-    Py_CLEAR(self->hunks);
     git_patch_free(self->patch);
     PyObject_Del(self);
 }
 
+static PyObject *
+wrap_patch_view(PyTypeObject *type, Patch *patch, size_t hunk)
+{
+    PatchView *view;
+
+    view = PyObject_New(PatchView, type);
+    if (view) {
+        Py_INCREF(patch);
+        view->patch = patch;
+        view->hunk = hunk;
+    }
+
+    return (PyObject*) view;
+}
+
+PyObject *
+wrap_patch_lines(Patch *patch, size_t hunk)
+{
+    return wrap_patch_view(&PatchLinesType, patch, hunk);
+}
+
+PyDoc_STRVAR(Patch_hunks__doc__,
+  "Hunks, a sequence of DiffHunk objects made as they are accessed.");
+
+PyObject *
+Patch_hunks__get__(Patch *self)
+{
+    return wrap_patch_view(&PatchHunksType, self, 0);
+}
+
 PyDoc_STRVAR(Patch_delta__doc__, "Get the delta associated with a patch.");
 
 PyObject *
@@ -103,13 +127,9 @@ Patch_line_stats__get__(Patch *self)
     return Py_BuildValue("III", context, additions, deletions);
 }
 
-PyMemberDef Patch_members[] = {
-    MEMBER(Patch, hunks, T_OBJECT, "hunks"),
-    {NULL}
-};
-
 PyGetSetDef Patch_getseters[] = {
     GETTER(Patch, delta),
+    GETTER(Patch, hunks),
     GETTER(Patch, line_stats),
     {NULL}
 };
@@ -145,7 +165,7 @@ PyTypeObject PatchType = {
     0,                                         /* tp_iter           */
     0,                                         /* tp_iternext       */
     0,                                         /* tp_methods        */
-    Patch_members,                             /* tp_members        */
+    0,                                         /* tp_members        */
     Patch_getseters,                           /* tp_getset         */
     0,                                         /* tp_base           */
     0,                                         /* tp_dict           */
@@ -156,3 +176,146 @@ PyTypeObject PatchType = {
     0,                                         /* tp_alloc          */
     0,                                         /* tp_new            */
 };
+
+
+static void
+PatchView_dealloc(PatchView *self)
+{
+    Py_CLEAR(self->patch);
+    PyObject_Del(self);
+}
+
+static Py_ssize_t
+PatchView_len(PatchView *self)
+{
+    if (Py_TYPE(self) == &PatchHunksType)
+        return (Py_ssize_t)git_patch_num_hunks(self->patch->patch);
+
+    return (Py_ssize_t)git_patch_num_lines_in_hunk(self->patch->patch,
+                                                    self->hunk);
+}
+
+static PyObject *
+PatchView_item(PatchView *self, Py_ssize_t i)
+{
+    const git_diff_line *line;
+    int err;
+
+    if (i < 0 || i >= PatchView_len(self)) {
+        PyErr_SetString(PyExc_IndexError, "index out of range");
+        return NULL;
+    }
+
+    if (Py_TYPE(self) == &PatchHunksType)
+        return wrap_diff_hunk(self->patch, i);
+
+    err = git_patch_get_line_in_hunk(&line, self->patch->patch, self->hunk,
+                                     i);
+    if (err < 0)
+        return Error_set(err);
+
+    return wrap_diff_line(line);
+}
+
+/* Integers, and slices for which a list is returned */
+static PyObject *
+PatchView_subscript(PatchView *self, PyObject *key)
+{
+    Py_ssize_t i, start, stop, step, n;
+    PyObject *list, *item;
+
+    if (PySlice_Check(key)) {
+        if (PySlice_GetIndicesEx((void *)key, PatchView_len(self), &start,
+                                 &stop, &step, &n) < 0)
+            return NULL;
+
+        list = PyList_New(n);
+        if (list == NULL)
+            return NULL;
+
+        for (i = 0; i < n; i++, start += step) {
+            item = PatchView_item(self, start);
+            if (item == NULL) {
+                Py_DECREF(list);
+                return NULL;
+            }
+            PyList_SET_ITEM(list, i, item);
+        }
+
+        return list;
+    }
+
+    i = PyNumber_AsSsize_t(key, PyExc_IndexError);
+    if (i == -1 && PyErr_Occurred())
+        return NULL;
+
+    if (i < 0)
+        i += PatchView_len(self);
+
+    return PatchView_item(self, i);
+}
+
+PySequenceMethods PatchView_as_sequence = {
+    (lenfunc)PatchView_len,          /* sq_length */
+    0,                               /* sq_concat */
+    0,                               /* sq_repeat */
+    (ssizeargfunc)PatchView_item,    /* sq_item */
+};
+
+PyMappingMethods PatchView_as_mapping = {
+    (lenfunc)PatchView_len,             /* mp_length */
+    (binaryfunc)PatchView_subscript,    /* mp_subscript */
+    0,                                  /* mp_ass_subscript */
+};
+
+PyDoc_STRVAR(PatchHunks__doc__, "The hunks of a patch.");
+
+PyTypeObject PatchHunksType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.PatchHunks",                      /* tp_name           */
+    sizeof(PatchView),                         /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)PatchView_dealloc,             /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    &PatchView_as_sequence,                    /* tp_as_sequence    */
+    &PatchView_as_mapping,                     /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    PatchHunks__doc__,                         /* tp_doc            */
+};
+
+PyDoc_STRVAR(PatchLines__doc__, "The lines of a hunk.");
+
+PyTypeObject PatchLinesType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.PatchLines",                      /* tp_name           */
+    sizeof(PatchView),                         /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)PatchView_dealloc,             /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    &PatchView_as_sequence,                    /* tp_as_sequence    */
+    &PatchView_as_mapping,                     /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    PatchLines__doc__,                         /* tp_doc            */
+};
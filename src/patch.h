@@ -31,7 +31,9 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 #include <git2.h>
+#include "types.h"
 
 PyObject* wrap_patch(git_patch *patch);
+PyObject* wrap_patch_lines(Patch *patch, size_t hunk);
 
 #endif
@@ -39,24 +39,33 @@
 extern PyObject *GitError;
 
 extern PyTypeObject RepositoryType;
+extern PyTypeObject OdbObjectType;
+extern PyTypeObject OdbReaderType;
+extern PyTypeObject OdbIterType;
+extern PyTypeObject PackWriterType;
 extern PyTypeObject OidType;
 extern PyTypeObject ObjectType;
 extern PyTypeObject CommitType;
 extern PyTypeObject DiffType;
 extern PyTypeObject DiffIterType;
+extern PyTypeObject DiffPatchIterType;
 extern PyTypeObject DiffDeltaType;
 extern PyTypeObject DiffFileType;
 extern PyTypeObject DiffHunkType;
 extern PyTypeObject DiffLineType;
 extern PyTypeObject DiffStatsType;
 extern PyTypeObject PatchType;
+extern PyTypeObject PatchHunksType;
+extern PyTypeObject PatchLinesType;
 extern PyTypeObject TreeType;
 extern PyTypeObject TreeBuilderType;
 extern PyTypeObject TreeEntryType;
 extern PyTypeObject TreeIterType;
+extern PyTypeObject TreeWalkIterType;
 extern PyTypeObject BlobType;
 extern PyTypeObject TagType;
 extern PyTypeObject WalkerType;
+extern PyTypeObject ParallelWalkerType;
 extern PyTypeObject ReferenceType;
 extern PyTypeObject RefLogIterType;
 extern PyTypeObject RefLogEntryType;
@@ -170,6 +179,12 @@ moduleinit(PyObject* m)
     ADD_CONSTANT_INT(m, GIT_OPT_SET_SEARCH_PATH);
     ADD_CONSTANT_INT(m, GIT_OPT_GET_MWINDOW_SIZE);
     ADD_CONSTANT_INT(m, GIT_OPT_SET_MWINDOW_SIZE);
+    ADD_CONSTANT_INT(m, GIT_OPT_GET_MWINDOW_MAPPED_LIMIT);
+    ADD_CONSTANT_INT(m, GIT_OPT_SET_MWINDOW_MAPPED_LIMIT);
+    ADD_CONSTANT_INT(m, GIT_OPT_SET_CACHE_OBJECT_LIMIT);
+    ADD_CONSTANT_INT(m, GIT_OPT_SET_CACHE_MAX_SIZE);
+    ADD_CONSTANT_INT(m, GIT_OPT_ENABLE_CACHING);
+    ADD_CONSTANT_INT(m, GIT_OPT_GET_CACHED_MEMORY);
 
     /* Errors */
     GitError = PyErr_NewException("_pygit2.GitError", NULL, NULL);
@@ -179,6 +194,13 @@ moduleinit(PyObject* m)
     /* Repository */
     INIT_TYPE(RepositoryType, NULL, PyType_GenericNew)
     ADD_TYPE(m, Repository)
+    INIT_TYPE(OdbObjectType, NULL, NULL)
+    INIT_TYPE(OdbReaderType, NULL, NULL)
+    INIT_TYPE(OdbIterType, NULL, NULL)
+    ADD_TYPE(m, OdbObject)
+    ADD_TYPE(m, OdbReader)
+    INIT_TYPE(PackWriterType, NULL, NULL)
+    ADD_TYPE(m, PackWriter)
 
     /* Oid */
     INIT_TYPE(OidType, NULL, PyType_GenericNew)
@@ -197,6 +219,7 @@ moduleinit(PyObject* m)
     INIT_TYPE(TreeType, &ObjectType, NULL)
     INIT_TYPE(TreeEntryType, NULL, NULL)
     INIT_TYPE(TreeIterType, NULL, NULL)
+    INIT_TYPE(TreeWalkIterType, NULL, NULL)
     INIT_TYPE(TreeBuilderType, NULL, NULL)
     INIT_TYPE(BlobType, &ObjectType, NULL)
     INIT_TYPE(TagType, &ObjectType, NULL)
@@ -219,12 +242,17 @@ moduleinit(PyObject* m)
     ADD_CONSTANT_INT(m, GIT_FILEMODE_BLOB_EXECUTABLE)
     ADD_CONSTANT_INT(m, GIT_FILEMODE_LINK)
     ADD_CONSTANT_INT(m, GIT_FILEMODE_COMMIT)
+    /* Tree.walk() */
+    ADD_CONSTANT_INT(m, GIT_TREEWALK_PRE)
+    ADD_CONSTANT_INT(m, GIT_TREEWALK_POST)
 
     /*
      * Log
      */
     INIT_TYPE(WalkerType, NULL, NULL)
     ADD_TYPE(m, Walker);
+    INIT_TYPE(ParallelWalkerType, NULL, NULL)
+    ADD_TYPE(m, ParallelWalker);
     ADD_CONSTANT_INT(m, GIT_SORT_NONE)
     ADD_CONSTANT_INT(m, GIT_SORT_TOPOLOGICAL)
     ADD_CONSTANT_INT(m, GIT_SORT_TIME)
@@ -291,12 +319,15 @@ moduleinit(PyObject* m)
      */
     INIT_TYPE(DiffType, NULL, NULL)
     INIT_TYPE(DiffIterType, NULL, NULL)
+    INIT_TYPE(DiffPatchIterType, NULL, NULL)
     INIT_TYPE(DiffDeltaType, NULL, NULL)
     INIT_TYPE(DiffFileType, NULL, NULL)
     INIT_TYPE(DiffHunkType, NULL, NULL)
     INIT_TYPE(DiffLineType, NULL, NULL)
     INIT_TYPE(DiffStatsType, NULL, NULL)
     INIT_TYPE(PatchType, NULL, NULL)
+    INIT_TYPE(PatchHunksType, NULL, NULL)
+    INIT_TYPE(PatchLinesType, NULL, NULL)
     ADD_TYPE(m, Diff)
     ADD_TYPE(m, DiffDelta)
     ADD_TYPE(m, DiffFile)
@@ -341,6 +372,18 @@ moduleinit(PyObject* m)
     ADD_CONSTANT_INT(m, GIT_DIFF_FIND_COPIES_FROM_UNMODIFIED)
     /* --break-rewrites=/M */
     ADD_CONSTANT_INT(m, GIT_DIFF_FIND_AND_BREAK_REWRITES)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_BY_CONFIG)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_REWRITES)
+    ADD_CONSTANT_INT(m, GIT_DIFF_BREAK_REWRITES)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_FOR_UNTRACKED)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_ALL)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_IGNORE_LEADING_WHITESPACE)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_IGNORE_WHITESPACE)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_DONT_IGNORE_WHITESPACE)
+    /* Compare ids only, no content is loaded */
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_EXACT_MATCH_ONLY)
+    ADD_CONSTANT_INT(m, GIT_DIFF_BREAK_REWRITES_FOR_RENAMES_ONLY)
+    ADD_CONSTANT_INT(m, GIT_DIFF_FIND_REMOVE_UNMODIFIED)
 
     /* DiffDelta and DiffFile flags */
     ADD_CONSTANT_INT(m, GIT_DIFF_FLAG_BINARY)
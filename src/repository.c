@@ -37,6 +37,11 @@
 #include "repository.h"
 #include "branch.h"
 #include "signature.h"
+#include "odb.h"
+#include "packwriter.h"
+#include "objectcache.h"
+#include "graph.h"
+#include "walker.h"
 #include <git2/odb_backend.h>
 
 extern PyObject *GitError;
@@ -70,6 +75,21 @@ int_to_loose_object_type(int type_id)
     }
 }
 
+static int
+Repository_init_lock(Repository *self)
+{
+    if (self->lock != NULL)
+        return 0;
+
+    self->lock = PyThread_allocate_lock();
+    if (self->lock == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    return 0;
+}
+
 PyObject *
 wrap_repository(git_repository *c_repo)
 {
@@ -80,6 +100,15 @@ wrap_repository(git_repository *c_repo)
         py_repo->config = NULL;
         py_repo->index = NULL;
         py_repo->owned = 1;
+        py_repo->lock = NULL;
+        ObjectCache_init(&py_repo->cache);
+        py_repo->graph = NULL;
+        py_repo->graph_checked = 0;
+        PyObject_GC_Track(py_repo);
+        if (Repository_init_lock(py_repo) < 0) {
+            Py_DECREF(py_repo);
+            return NULL;
+        }
     }
 
     return (PyObject *)py_repo;
@@ -100,7 +129,12 @@ Repository_init(Repository *self, PyObject *args, PyObject *kwds)
     if (!PyArg_ParseTuple(args, "s", &path))
         return -1;
 
+    if (Repository_init_lock(self) < 0)
+        return -1;
+
+    Py_BEGIN_ALLOW_THREADS
     err = git_repository_open(&self->repo, path);
+    Py_END_ALLOW_THREADS
     if (err < 0) {
         Error_set_str(err, path);
         return -1;
@@ -138,6 +172,9 @@ Repository__from_c(Repository *py_repo, PyObject *args)
         return NULL;
     }
 
+    if (Repository_init_lock(py_repo) < 0)
+        return NULL;
+
     py_repo->repo = *((git_repository **) buffer);
     py_repo->owned = py_free == Py_True;
 
@@ -152,6 +189,31 @@ Repository__disown(Repository *py_repo)
     Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR(Repository__lock__doc__,
+  "Take the lock guarding the index, the working directory and the\n"
+  "walkers, waiting for it with the GIL released.  For internal use only:\n"
+  "the lock must be released with _unlock() before the next call that\n"
+  "takes it.");
+
+PyObject *
+Repository__lock(Repository *self)
+{
+    Py_BEGIN_ALLOW_THREADS
+    PyThread_acquire_lock(self->lock, WAIT_LOCK);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(Repository__unlock__doc__,
+  "Release the lock taken by _lock().  For internal use only.");
+
+PyObject *
+Repository__unlock(Repository *self)
+{
+    PyThread_release_lock(self->lock);
+    Py_RETURN_NONE;
+}
+
 void
 Repository_dealloc(Repository *self)
 {
@@ -162,6 +224,11 @@ Repository_dealloc(Repository *self)
     if (self->owned)
         git_repository_free(self->repo);
 
+    if (self->lock != NULL)
+        PyThread_free_lock(self->lock);
+
+    ObjectCache_free(&self->cache);
+    commit_graph_decref(self->graph);
     Py_TYPE(self)->tp_free(self);
 }
 
@@ -169,50 +236,47 @@ int
 Repository_traverse(Repository *self, visitproc visit, void *arg)
 {
     Py_VISIT(self->index);
-    return 0;
+    return ObjectCache_traverse(&self->cache, visit, arg);
 }
 
 int
 Repository_clear(Repository *self)
 {
     Py_CLEAR(self->index);
+    ObjectCache_clear(&self->cache);
     return 0;
 }
 
-static int
-Repository_build_as_iter(const git_oid *oid, void *accum)
+PyObject *
+Repository_as_iter(Repository *self)
 {
-    int err;
-    PyObject *py_oid = git_oid_to_python(oid);
-
-    err = PyList_Append((PyObject*)accum, py_oid);
-    Py_DECREF(py_oid);
-    return err;
+    return wrap_odb_iter(self, GIT_OBJ_ANY);
 }
 
+
+PyDoc_STRVAR(Repository_iter_objects__doc__,
+  "iter_objects([type]) -> iterator\n"
+  "\n"
+  "Iterate over the ids of the objects in the object database, optionally\n"
+  "only those of the given type (one of GIT_OBJ_COMMIT, GIT_OBJ_TREE,\n"
+  "GIT_OBJ_BLOB or GIT_OBJ_TAG).  The database is read lazily, in chunks,\n"
+  "by a background thread.");
+
 PyObject *
-Repository_as_iter(Repository *self)
+Repository_iter_objects(Repository *self, PyObject *args)
 {
-    git_odb *odb;
-    int err;
-    PyObject *accum = PyList_New(0);
-    PyObject *ret;
-
-    err = git_repository_odb(&odb, self->repo);
-    if (err < 0)
-        return Error_set(err);
+    int type_id = GIT_OBJ_ANY;
+    git_otype type;
 
-    err = git_odb_foreach(odb, Repository_build_as_iter, (void*)accum);
-    git_odb_free(odb);
-    if (err == GIT_EUSER)
+    if (!PyArg_ParseTuple(args, "|i", &type_id))
         return NULL;
-    if (err < 0)
-        return Error_set(err);
 
-    ret = PyObject_GetIter(accum);
-    Py_DECREF(accum);
+    type = (type_id == GIT_OBJ_ANY) ? GIT_OBJ_ANY
+                                    : int_to_loose_object_type(type_id);
+    if (type == GIT_OBJ_BAD)
+        return PyErr_Format(PyExc_ValueError, "%d", type_id);
 
-    return ret;
+    return wrap_odb_iter(self, type);
 }
 
 
@@ -304,14 +368,27 @@ Repository_git_object_lookup_prefix(Repository *self, PyObject *key)
     size_t len;
     git_oid oid;
     git_object *obj;
+    PyObject *py_obj;
 
     len = py_oid_to_git_oid(key, &oid);
     if (len == 0)
         return NULL;
 
+    if (len == GIT_OID_HEXSZ) {
+        py_obj = ObjectCache_get(&self->cache, &oid);
+        if (py_obj != NULL)
+            return py_obj;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
     err = git_object_lookup_prefix(&obj, self->repo, &oid, len, GIT_OBJ_ANY);
-    if (err == 0)
+    Py_END_ALLOW_THREADS
+    if (err == 0) {
+        /* A full id has already been counted as a miss */
+        if (len == GIT_OID_HEXSZ)
+            return wrap_new_object(obj, self);
         return wrap_object(obj, self);
+    }
 
     if (err == GIT_ENOTFOUND)
         Py_RETURN_NONE;
@@ -370,7 +447,9 @@ Repository_revparse_single(Repository *self, PyObject *py_spec)
         return NULL;
 
     /* 2- Lookup */
+    Py_BEGIN_ALLOW_THREADS
     err = git_revparse_single(&c_obj, self->repo, c_spec);
+    Py_END_ALLOW_THREADS
 
     if (err < 0) {
         PyObject *err_obj = Error_set_str(err, c_spec);
@@ -395,8 +474,10 @@ Repository_read_raw(git_repository *repo, const git_oid *oid, size_t len)
         return NULL;
     }
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_odb_read_prefix(&obj, odb, oid, (unsigned int)len);
     git_odb_free(odb);
+    Py_END_ALLOW_THREADS
     if (err < 0) {
         Error_set_oid(err, oid, len);
         return NULL;
@@ -406,169 +487,1149 @@ Repository_read_raw(git_repository *repo, const git_oid *oid, size_t len)
 }
 
 
-PyDoc_STRVAR(Repository_read__doc__,
-  "read(oid) -> type, data, size\n"
+PyDoc_STRVAR(Repository_read__doc__,
+  "read(oid) -> type, data, size\n"
+  "\n"
+  "Read raw object data from the repository.");
+
+PyObject *
+Repository_read(Repository *self, PyObject *py_hex)
+{
+    git_oid oid;
+    git_odb_object *obj;
+    size_t len;
+    PyObject* tuple;
+
+    len = py_oid_to_git_oid(py_hex, &oid);
+    if (len == 0)
+        return NULL;
+
+    obj = Repository_read_raw(self->repo, &oid, len);
+    if (obj == NULL)
+        return NULL;
+
+    tuple = Py_BuildValue(
+    #if PY_MAJOR_VERSION == 2
+        "(ns#)",
+    #else
+        "(ny#)",
+    #endif
+        git_odb_object_type(obj),
+        git_odb_object_data(obj),
+        git_odb_object_size(obj));
+
+    git_odb_object_free(obj);
+    return tuple;
+}
+
+
+PyDoc_STRVAR(Repository_read_buffer__doc__,
+  "read_buffer(oid) -> OdbObject\n"
+  "\n"
+  "Read raw object data from the repository without copying it. The\n"
+  "returned OdbObject supports the buffer interface.");
+
+PyObject *
+Repository_read_buffer(Repository *self, PyObject *py_hex)
+{
+    git_oid oid;
+    git_odb_object *obj;
+    size_t len;
+
+    len = py_oid_to_git_oid(py_hex, &oid);
+    if (len == 0)
+        return NULL;
+
+    obj = Repository_read_raw(self->repo, &oid, len);
+    if (obj == NULL)
+        return NULL;
+
+    return wrap_odb_object(obj);
+}
+
+
+PyDoc_STRVAR(Repository_open_reader__doc__,
+  "open_reader(oid[, chunk_size]) -> OdbReader\n"
+  "\n"
+  "Open the raw data of an object for reading, as a file-like object with\n"
+  "read(), readinto() and close() methods. Iterating over the reader\n"
+  "yields the data in chunks of chunk_size bytes (64 KiB by default).\n"
+  "\n"
+  "Loose objects are inflated as they are read, and their hash is checked\n"
+  "when the end is reached.  Packed objects can not be streamed by libgit2,\n"
+  "so they are loaded whole.");
+
+PyObject *
+Repository_open_reader(Repository *self, PyObject *args)
+{
+    PyObject *py_oid;
+    Py_ssize_t chunk_size = ODB_READER_CHUNK_SIZE;
+    git_oid oid;
+    int err;
+
+    if (!PyArg_ParseTuple(args, "O|n", &py_oid, &chunk_size))
+        return NULL;
+
+    err = py_oid_to_git_oid_expand(self->repo, py_oid, &oid);
+    if (err < 0)
+        return NULL;
+
+    return wrap_odb_reader(self, &oid, chunk_size);
+}
+
+
+/*
+ * Converts a sequence of oids (Oid objects or hex strings) to C. Returns the
+ * number of oids, or -1 on error; on success the caller owns *oids and *lens.
+ */
+static Py_ssize_t
+py_oid_seq_to_git_oids(PyObject *py_oids, git_oid **oids, size_t **lens)
+{
+    PyObject *seq;
+    Py_ssize_t i, n;
+
+    seq = PySequence_Fast(py_oids, "expected a sequence of oids");
+    if (seq == NULL)
+        return -1;
+
+    n = PySequence_Fast_GET_SIZE(seq);
+    *oids = malloc((n ? n : 1) * sizeof(git_oid));
+    *lens = malloc((n ? n : 1) * sizeof(size_t));
+    if (*oids == NULL || *lens == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    for (i = 0; i < n; i++) {
+        (*lens)[i] = py_oid_to_git_oid(PySequence_Fast_GET_ITEM(seq, i),
+                                       &(*oids)[i]);
+        if ((*lens)[i] == 0)
+            goto error;
+    }
+
+    Py_DECREF(seq);
+    return n;
+
+error:
+    free(*oids);
+    free(*lens);
+    Py_DECREF(seq);
+    return -1;
+}
+
+
+/*
+ * Converts a sequence of oids, expanding short ones.  Returns the number of
+ * oids, or -1 on error; on success the caller owns *oids.
+ */
+static Py_ssize_t
+py_oid_seq_to_git_oids_expand(Repository *self, PyObject *py_oids,
+                              git_oid **oids)
+{
+    PyObject *seq;
+    Py_ssize_t i, n;
+
+    seq = PySequence_Fast(py_oids, "expected a sequence of oids");
+    if (seq == NULL)
+        return -1;
+
+    n = PySequence_Fast_GET_SIZE(seq);
+    *oids = malloc((n ? n : 1) * sizeof(git_oid));
+    if (*oids == NULL) {
+        PyErr_NoMemory();
+        goto error;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (py_oid_to_git_oid_expand(self->repo,
+                                     PySequence_Fast_GET_ITEM(seq, i),
+                                     &(*oids)[i]) < 0)
+            goto error;
+    }
+
+    Py_DECREF(seq);
+    return n;
+
+error:
+    free(*oids);
+    Py_DECREF(seq);
+    return -1;
+}
+
+
+PyDoc_STRVAR(Repository_read_many__doc__,
+  "read_many(oids) -> [(type, data), ...]\n"
+  "\n"
+  "Read the raw data of many objects at once. All the objects are read\n"
+  "through a single handle on the object database, with the GIL released.\n"
+  "Raises KeyError if any of them is missing.");
+
+PyObject *
+Repository_read_many(Repository *self, PyObject *py_oids)
+{
+    git_oid *oids;
+    size_t *lens;
+    git_odb *odb;
+    git_odb_object **objs;
+    Py_ssize_t i, n;
+    PyObject *list = NULL;
+    int err = 0;
+
+    n = py_oid_seq_to_git_oids(py_oids, &oids, &lens);
+    if (n < 0)
+        return NULL;
+
+    objs = calloc(n ? n : 1, sizeof(git_odb_object *));
+    if (objs == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    err = git_repository_odb(&odb, self->repo);
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++) {
+        if (lens[i] == GIT_OID_HEXSZ)
+            err = git_odb_read(&objs[i], odb, &oids[i]);
+        else
+            err = git_odb_read_prefix(&objs[i], odb, &oids[i], lens[i]);
+        if (err < 0)
+            break;
+    }
+    git_odb_free(odb);
+    Py_END_ALLOW_THREADS
+
+    if (err < 0) {
+        Error_set_oid(err, &oids[i], lens[i]);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n; i++) {
+        PyObject *tuple = Py_BuildValue(
+        #if PY_MAJOR_VERSION == 2
+            "(ns#)",
+        #else
+            "(ny#)",
+        #endif
+            git_odb_object_type(objs[i]),
+            git_odb_object_data(objs[i]),
+            git_odb_object_size(objs[i]));
+        if (tuple == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+exit:
+    if (objs != NULL) {
+        for (i = 0; i < n; i++)
+            git_odb_object_free(objs[i]);
+        free(objs);
+    }
+    free(oids);
+    free(lens);
+    return list;
+}
+
+
+PyDoc_STRVAR(Repository_lookup_many__doc__,
+  "lookup_many(oids) -> [Object, ...]\n"
+  "\n"
+  "Look up many objects at once, with the GIL released while libgit2 reads\n"
+  "them. Missing objects are returned as None.");
+
+PyObject *
+Repository_lookup_many(Repository *self, PyObject *py_oids)
+{
+    git_oid *oids;
+    size_t *lens;
+    git_object **objs;
+    Py_ssize_t i, n;
+    PyObject *list = NULL;
+    int err = 0;
+
+    n = py_oid_seq_to_git_oids(py_oids, &oids, &lens);
+    if (n < 0)
+        return NULL;
+
+    objs = calloc(n ? n : 1, sizeof(git_object *));
+    if (objs == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    for (i = 0; i < n; i++) {
+        err = git_object_lookup_prefix(&objs[i], self->repo, &oids[i], lens[i],
+                                       GIT_OBJ_ANY);
+        if (err == GIT_ENOTFOUND) {
+            objs[i] = NULL;
+            err = 0;
+        }
+        if (err < 0)
+            break;
+    }
+    Py_END_ALLOW_THREADS
+
+    if (err < 0) {
+        Error_set_oid(err, &oids[i], lens[i]);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n; i++) {
+        PyObject *py_obj;
+
+        if (objs[i] == NULL) {
+            Py_INCREF(Py_None);
+            PyList_SET_ITEM(list, i, Py_None);
+            continue;
+        }
+
+        /* wrap_object takes ownership, even on failure */
+        py_obj = wrap_object(objs[i], self);
+        objs[i] = NULL;
+        if (py_obj == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, py_obj);
+    }
+
+exit:
+    if (objs != NULL) {
+        for (i = 0; i < n; i++)
+            git_object_free(objs[i]);
+        free(objs);
+    }
+    free(oids);
+    free(lens);
+    return list;
+}
+
+
+PyDoc_STRVAR(Repository_write__doc__,
+    "write(type, data) -> Oid\n"
+    "\n"
+    "Write raw object data into the repository. First arg is the object\n"
+    "type, the second one a buffer with data. Return the Oid of the created\n"
+    "object.");
+
+PyObject *
+Repository_write(Repository *self, PyObject *args)
+{
+    int err;
+    git_oid oid;
+    git_odb *odb;
+    git_odb_stream* stream;
+    int type_id;
+    const char* buffer;
+    Py_ssize_t buflen;
+    git_otype type;
+
+    if (!PyArg_ParseTuple(args, "Is#", &type_id, &buffer, &buflen))
+        return NULL;
+
+    type = int_to_loose_object_type(type_id);
+    if (type == GIT_OBJ_BAD)
+        return PyErr_Format(PyExc_ValueError, "%d", type_id);
+
+    err = git_repository_odb(&odb, self->repo);
+    if (err < 0)
+        return Error_set(err);
+
+    err = git_odb_open_wstream(&stream, odb, buflen, type);
+    git_odb_free(odb);
+    if (err < 0)
+        return Error_set(err);
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_odb_stream_write(stream, buffer, buflen);
+    if (err == 0)
+        err = git_odb_stream_finalize_write(&oid, stream);
+    git_odb_stream_free(stream);
+    Py_END_ALLOW_THREADS
+    if (err)
+        return Error_set(err);
+
+    return git_oid_to_python(&oid);
+}
+
+PyDoc_STRVAR(Repository_path__doc__,
+  "The normalized path to the git repository.");
+
+PyObject *
+Repository_path__get__(Repository *self, void *closure)
+{
+    return to_path(git_repository_path(self->repo));
+}
+
+
+PyDoc_STRVAR(Repository_workdir__doc__,
+  "The normalized path to the working directory of the repository. If the\n"
+  "repository is bare, None will be returned.");
+
+PyObject *
+Repository_workdir__get__(Repository *self, void *closure)
+{
+    const char *c_path;
+
+    c_path = git_repository_workdir(self->repo);
+    if (c_path == NULL)
+        Py_RETURN_NONE;
+
+    return to_path(c_path);
+}
+
+int
+Repository_workdir__set__(Repository *self, PyObject *py_workdir)
+{
+    int err;
+    const char *workdir;
+    PyObject *tworkdir;
+
+    workdir = py_str_borrow_c_str(&tworkdir, py_workdir, NULL);
+    if (workdir == NULL)
+        return -1;
+
+    err = git_repository_set_workdir(self->repo, workdir, 0 /* update_gitlink */);
+    Py_DECREF(tworkdir);
+    if (err < 0) {
+        Error_set_str(err, workdir);
+        return -1;
+    }
+
+    return 0;
+}
+
+PyDoc_STRVAR(Repository_object_cache_size__doc__,
+  "The maximum number of objects kept in the object cache.  While it is\n"
+  "not zero, looking up an object that is already cached returns the same\n"
+  "Python object instead of allocating a new one; the least recently used\n"
+  "objects are dropped past the limit.  It is zero (disabled) by default,\n"
+  "setting it to zero empties the cache.\n"
+  "\n"
+  "The cache keeps the most recently used objects alive.  An object that\n"
+  "is dropped from it is still reused for as long as something else refers\n"
+  "to it.");
+
+PyObject *
+Repository_object_cache_size__get__(Repository *self, void *closure)
+{
+    return PyLong_FromSize_t(self->cache.capacity);
+}
+
+int
+Repository_object_cache_size__set__(Repository *self, PyObject *py_size)
+{
+    Py_ssize_t size;
+
+    if (py_size == NULL) {
+        PyErr_SetString(PyExc_TypeError, "cannot delete object_cache_size");
+        return -1;
+    }
+
+    size = PyNumber_AsSsize_t(py_size, PyExc_OverflowError);
+    if (size == -1 && PyErr_Occurred())
+        return -1;
+
+    if (size < 0) {
+        PyErr_SetString(PyExc_ValueError,
+                        "object_cache_size must not be negative");
+        return -1;
+    }
+
+    return ObjectCache_resize(&self->cache, (size_t)size);
+}
+
+PyDoc_STRVAR(Repository_object_cache_stats__doc__,
+  "A dictionary with the object cache statistics: the number of lookups\n"
+  "served from the cache ('hits'), the number that were not ('misses'), and\n"
+  "the number of objects the cache keeps alive ('size'), at most\n"
+  "object_cache_size.");
+
+PyObject *
+Repository_object_cache_stats__get__(Repository *self, void *closure)
+{
+    return Py_BuildValue("{s:n,s:n,s:n}",
+                         "hits", (Py_ssize_t)self->cache.hits,
+                         "misses", (Py_ssize_t)self->cache.misses,
+                         "size", (Py_ssize_t)self->cache.size);
+}
+
+PyDoc_STRVAR(Repository_merge_base__doc__,
+  "merge_base(oid, oid) -> Oid\n"
+  "\n"
+  "Find as good common ancestors as possible for a merge.");
+
+PyObject *
+Repository_merge_base(Repository *self, PyObject *args)
+{
+    PyObject *value1;
+    PyObject *value2;
+    git_oid oid;
+    git_oid oid1;
+    git_oid oid2;
+    CommitGraph *graph;
+    uint32_t pos, pos1, pos2;
+    int err;
+
+    if (!PyArg_ParseTuple(args, "OO", &value1, &value2))
+        return NULL;
+
+    err = py_oid_to_git_oid_expand(self->repo, value1, &oid1);
+    if (err < 0)
+        return NULL;
+
+    err = py_oid_to_git_oid_expand(self->repo, value2, &oid2);
+    if (err < 0)
+        return NULL;
+
+    graph = Repository_get_commit_graph(self);
+    if (graph != NULL) {
+        if (commit_graph_find(graph, &oid1, &pos1) &&
+            commit_graph_find(graph, &oid2, &pos2)) {
+            Py_BEGIN_ALLOW_THREADS
+            err = commit_graph_merge_base(&pos, graph, pos1, pos2);
+            Py_END_ALLOW_THREADS
+            if (err == 0)
+                git_oid_cpy(&oid, COMMIT_GRAPH_OID(graph, pos));
+            commit_graph_decref(graph);
+            if (err == 0)
+                return git_oid_to_python(&oid);
+
+            /* With several merge bases, let libgit2 choose */
+            if (err != GIT_EAMBIGUOUS)
+                return Error_set(err);
+            giterr_clear();
+        } else {
+            commit_graph_decref(graph);
+        }
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    err = git_merge_base(&oid, self->repo, &oid1, &oid2);
+    Py_END_ALLOW_THREADS
+    if (err < 0)
+        return Error_set(err);
+
+    return git_oid_to_python(&oid);
+}
+
+PyDoc_STRVAR(Repository__ahead_behind_graph__doc__,
+  "_ahead_behind_graph(local, upstream) -> (int, int) or None\n"
+  "\n"
+  "ahead_behind() from the commit-graph, None if the graph does not have\n"
+  "both commits.  For internal use only.");
+
+PyObject *
+Repository__ahead_behind_graph(Repository *self, PyObject *args)
+{
+    PyObject *py_local, *py_upstream;
+    CommitGraph *graph;
+    git_oid local, upstream;
+    uint32_t pos1, pos2;
+    size_t ahead, behind;
+    int err;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_local, &py_upstream))
+        return NULL;
+
+    if (py_oid_to_git_oid_expand(self->repo, py_local, &local) < 0 ||
+        py_oid_to_git_oid_expand(self->repo, py_upstream, &upstream) < 0)
+        return NULL;
+
+    graph = Repository_get_commit_graph(self);
+    if (graph == NULL)
+        Py_RETURN_NONE;
+
+    if (!commit_graph_find(graph, &local, &pos1) ||
+        !commit_graph_find(graph, &upstream, &pos2)) {
+        commit_graph_decref(graph);
+        Py_RETURN_NONE;
+    }
+
+    Py_BEGIN_ALLOW_THREADS
+    err = commit_graph_ahead_behind(&ahead, &behind, graph, pos1, pos2);
+    Py_END_ALLOW_THREADS
+    commit_graph_decref(graph);
+    if (err < 0)
+        return Error_set(err);
+
+    return Py_BuildValue("nn", (Py_ssize_t)ahead, (Py_ssize_t)behind);
+}
+
+/*
+ * Splits tips between those the commit-graph has (when it also has base) and
+ * the others.  On success, *graph is a new reference or NULL, in_graph[i]
+ * tells where tips[i] goes, and *positions holds the graph positions of the
+ * n_positions tips it has, in order.
+ */
+static int
+batch_split(Repository *self, CommitGraph **graph, const git_oid *base,
+            uint32_t *base_pos, const git_oid *tips, Py_ssize_t n,
+            char *in_graph, uint32_t **positions, size_t *n_positions)
+{
+    Py_ssize_t i;
+    uint32_t pos;
+
+    *positions = malloc((n ? n : 1) * sizeof(uint32_t));
+    if (*positions == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+
+    *n_positions = 0;
+    *graph = Repository_get_commit_graph(self);
+    if (*graph != NULL && !commit_graph_find(*graph, base, base_pos)) {
+        commit_graph_decref(*graph);
+        *graph = NULL;
+    }
+
+    for (i = 0; i < n; i++) {
+        in_graph[i] = *graph != NULL &&
+                      commit_graph_find(*graph, &tips[i], &pos);
+        if (in_graph[i])
+            (*positions)[(*n_positions)++] = pos;
+    }
+
+    return 0;
+}
+
+PyDoc_STRVAR(Repository_merge_base_batch__doc__,
+  "merge_base_batch(oids, base) -> [Oid or None, ...]\n"
+  "\n"
+  "Find the merge base of each commit of oids with base, or None when they\n"
+  "have no common ancestor.  All the pairs are computed in one call with\n"
+  "the GIL released.  With a commit-graph (see write_commit_graph) repeated\n"
+  "commits are computed once, and the pairs reuse the memory of a single\n"
+  "traversal, but each pair is still walked on its own.");
+
+PyObject *
+Repository_merge_base_batch(Repository *self, PyObject *args)
+{
+    PyObject *py_tips, *py_base, *list = NULL;
+    git_oid base, *tips = NULL, *bases = NULL;
+    CommitGraph *graph = NULL;
+    uint32_t base_pos, *positions = NULL, *graph_bases = NULL;
+    int *found = NULL, *graph_found = NULL;
+    char *in_graph = NULL;
+    size_t n_positions, j;
+    Py_ssize_t i, n;
+    int err = 0;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_tips, &py_base))
+        return NULL;
+
+    if (py_oid_to_git_oid_expand(self->repo, py_base, &base) < 0)
+        return NULL;
+
+    n = py_oid_seq_to_git_oids_expand(self, py_tips, &tips);
+    if (n < 0)
+        return NULL;
+
+    bases = malloc((n ? n : 1) * sizeof(git_oid));
+    graph_bases = malloc((n ? n : 1) * sizeof(uint32_t));
+    found = malloc((n ? n : 1) * sizeof(int));
+    graph_found = malloc((n ? n : 1) * sizeof(int));
+    in_graph = malloc(n ? n : 1);
+    if (bases == NULL || graph_bases == NULL || found == NULL ||
+        graph_found == NULL || in_graph == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    if (batch_split(self, &graph, &base, &base_pos, tips, n, in_graph,
+                    &positions, &n_positions) < 0)
+        goto exit;
+
+    Py_BEGIN_ALLOW_THREADS
+    if (n_positions > 0)
+        err = commit_graph_merge_base_many(graph_bases, graph_found, graph,
+                                           positions, n_positions, base_pos);
+
+    for (i = 0, j = 0; i < n && err == 0; i++) {
+        if (in_graph[i]) {
+            if (graph_found[j] > 0)
+                git_oid_cpy(&bases[i], COMMIT_GRAPH_OID(graph, graph_bases[j]));
+            found[i] = graph_found[j];
+            j++;
+            /* With several merge bases, let libgit2 choose */
+            if (found[i] >= 0)
+                continue;
+        }
+
+        err = git_merge_base(&bases[i], self->repo, &tips[i], &base);
+        found[i] = err == 0;
+        if (err == GIT_ENOTFOUND) {
+            giterr_clear();
+            err = 0;
+        }
+    }
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n; i++) {
+        PyObject *py_oid;
+
+        if (found[i]) {
+            py_oid = git_oid_to_python(&bases[i]);
+            if (py_oid == NULL) {
+                Py_CLEAR(list);
+                goto exit;
+            }
+        } else {
+            Py_INCREF(Py_None);
+            py_oid = Py_None;
+        }
+        PyList_SET_ITEM(list, i, py_oid);
+    }
+
+exit:
+    commit_graph_decref(graph);
+    free(tips);
+    free(bases);
+    free(positions);
+    free(graph_bases);
+    free(found);
+    free(graph_found);
+    free(in_graph);
+    return list;
+}
+
+PyDoc_STRVAR(Repository_ahead_behind_batch__doc__,
+  "ahead_behind_batch(oids, upstream) -> [(int, int), ...]\n"
+  "\n"
+  "Like ahead_behind(local, upstream) for each commit of oids as local,\n"
+  "computed all at once as merge_base_batch() does.");
+
+PyObject *
+Repository_ahead_behind_batch(Repository *self, PyObject *args)
+{
+    PyObject *py_tips, *py_upstream, *list = NULL;
+    git_oid upstream, *tips = NULL;
+    CommitGraph *graph = NULL;
+    uint32_t upstream_pos, *positions = NULL;
+    size_t *ahead = NULL, *behind = NULL, *graph_ahead = NULL;
+    size_t *graph_behind = NULL, n_positions, j;
+    char *in_graph = NULL;
+    Py_ssize_t i, n;
+    int err = 0;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_tips, &py_upstream))
+        return NULL;
+
+    if (py_oid_to_git_oid_expand(self->repo, py_upstream, &upstream) < 0)
+        return NULL;
+
+    n = py_oid_seq_to_git_oids_expand(self, py_tips, &tips);
+    if (n < 0)
+        return NULL;
+
+    ahead = malloc((n ? n : 1) * sizeof(size_t));
+    behind = malloc((n ? n : 1) * sizeof(size_t));
+    graph_ahead = malloc((n ? n : 1) * sizeof(size_t));
+    graph_behind = malloc((n ? n : 1) * sizeof(size_t));
+    in_graph = malloc(n ? n : 1);
+    if (ahead == NULL || behind == NULL || graph_ahead == NULL ||
+        graph_behind == NULL || in_graph == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
+
+    if (batch_split(self, &graph, &upstream, &upstream_pos, tips, n,
+                    in_graph, &positions, &n_positions) < 0)
+        goto exit;
+
+    Py_BEGIN_ALLOW_THREADS
+    if (n_positions > 0)
+        err = commit_graph_ahead_behind_many(graph_ahead, graph_behind,
+                                             graph, positions, n_positions,
+                                             upstream_pos);
+
+    for (i = 0, j = 0; i < n && err == 0; i++) {
+        if (in_graph[i]) {
+            ahead[i] = graph_ahead[j];
+            behind[i] = graph_behind[j];
+            j++;
+            continue;
+        }
+
+        err = git_graph_ahead_behind(&ahead[i], &behind[i], self->repo,
+                                     &tips[i], &upstream);
+    }
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < n; i++) {
+        PyObject *py_counts;
+
+        py_counts = Py_BuildValue("nn", (Py_ssize_t)ahead[i],
+                                  (Py_ssize_t)behind[i]);
+        if (py_counts == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, py_counts);
+    }
+
+exit:
+    commit_graph_decref(graph);
+    free(tips);
+    free(ahead);
+    free(behind);
+    free(graph_ahead);
+    free(graph_behind);
+    free(positions);
+    free(in_graph);
+    return list;
+}
+
+/* Returns a new reference to the reachability bitmap of tip, computing it
+ * (from the cached bitmaps of its ancestors) if needed */
+static ReachBitmap *
+get_reach_bitmap(CommitGraph *graph, uint32_t tip)
+{
+    ReachBitmap *bitmap, *bases[COMMIT_GRAPH_MAX_BITMAPS];
+    size_t n_bases, i;
+    int err;
+
+    bitmap = commit_graph_get_bitmap(graph, tip);
+    if (bitmap != NULL)
+        return bitmap;
+
+    n_bases = commit_graph_get_bitmaps(graph, bases);
+    Py_BEGIN_ALLOW_THREADS
+    err = commit_graph_compute_bitmap(&bitmap, graph, tip, bases, n_bases);
+    Py_END_ALLOW_THREADS
+    for (i = 0; i < n_bases; i++)
+        reach_bitmap_decref(bases[i]);
+    if (err < 0) {
+        Error_set(err);
+        return NULL;
+    }
+
+    bitmap->refcount++;
+    commit_graph_add_bitmap(graph, bitmap);
+    return bitmap;
+}
+
+PyDoc_STRVAR(Repository_is_ancestor_many__doc__,
+  "is_ancestor_many(ancestors, descendant) -> [bool, ...]\n"
   "\n"
-  "Read raw object data from the repository.");
+  "Tell, for each commit of ancestors, whether it is reachable from\n"
+  "descendant (a commit is reachable from itself).  With a commit-graph\n"
+  "(see write_commit_graph) the commits reachable from descendant are\n"
+  "computed once, as a bitmap kept for the next queries, and each answer\n"
+  "is then a lookup.");
 
 PyObject *
-Repository_read(Repository *self, PyObject *py_hex)
+Repository_is_ancestor_many(Repository *self, PyObject *args)
 {
-    git_oid oid;
-    git_odb_object *obj;
-    size_t len;
-    PyObject* tuple;
+    PyObject *py_ancestors, *py_descendant, *list = NULL;
+    git_oid descendant, base, *ancestors;
+    CommitGraph *graph;
+    ReachBitmap *bitmap = NULL;
+    uint32_t tip, pos;
+    char *result;
+    Py_ssize_t i, n;
+    int err = 0;
+
+    if (!PyArg_ParseTuple(args, "OO", &py_ancestors, &py_descendant))
+        return NULL;
 
-    len = py_oid_to_git_oid(py_hex, &oid);
-    if (len == 0)
+    if (py_oid_to_git_oid_expand(self->repo, py_descendant, &descendant) < 0)
         return NULL;
 
-    obj = Repository_read_raw(self->repo, &oid, len);
-    if (obj == NULL)
+    n = py_oid_seq_to_git_oids_expand(self, py_ancestors, &ancestors);
+    if (n < 0)
         return NULL;
 
-    tuple = Py_BuildValue(
-    #if PY_MAJOR_VERSION == 2
-        "(ns#)",
-    #else
-        "(ny#)",
-    #endif
-        git_odb_object_type(obj),
-        git_odb_object_data(obj),
-        git_odb_object_size(obj));
+    result = malloc(n ? n : 1);
+    if (result == NULL) {
+        PyErr_NoMemory();
+        goto exit;
+    }
 
-    git_odb_object_free(obj);
-    return tuple;
-}
+    graph = Repository_get_commit_graph(self);
+    if (graph != NULL && commit_graph_find(graph, &descendant, &tip)) {
+        bitmap = get_reach_bitmap(graph, tip);
+        if (bitmap != NULL) {
+            /* The graph is closed under ancestry: what it does not have
+             * cannot be an ancestor */
+            for (i = 0; i < n; i++)
+                result[i] = commit_graph_find(graph, &ancestors[i], &pos) &&
+                            REACH_BITMAP_TEST(bitmap, pos);
+            reach_bitmap_decref(bitmap);
+        }
+        commit_graph_decref(graph);
+        if (bitmap == NULL)
+            goto exit;
+    } else {
+        commit_graph_decref(graph);
+
+        Py_BEGIN_ALLOW_THREADS
+        for (i = 0; i < n; i++) {
+            err = git_merge_base(&base, self->repo, &ancestors[i],
+                                 &descendant);
+            if (err == GIT_ENOTFOUND) {
+                giterr_clear();
+                err = 0;
+                result[i] = 0;
+                continue;
+            }
+            if (err < 0)
+                break;
+            result[i] = git_oid_equal(&base, &ancestors[i]);
+        }
+        Py_END_ALLOW_THREADS
+        if (err < 0) {
+            Error_set(err);
+            goto exit;
+        }
+    }
 
+    list = PyList_New(n);
+    if (list == NULL)
+        goto exit;
 
-PyDoc_STRVAR(Repository_write__doc__,
-    "write(type, data) -> Oid\n"
-    "\n"
-    "Write raw object data into the repository. First arg is the object\n"
-    "type, the second one a buffer with data. Return the Oid of the created\n"
-    "object.");
+    for (i = 0; i < n; i++) {
+        PyObject *py_bool = result[i] ? Py_True : Py_False;
+        Py_INCREF(py_bool);
+        PyList_SET_ITEM(list, i, py_bool);
+    }
+
+exit:
+    free(ancestors);
+    free(result);
+    return list;
+}
+
+PyDoc_STRVAR(Repository_reachable_count__doc__,
+  "reachable_count(oid) -> int\n"
+  "\n"
+  "Return the number of commits reachable from the given commit, itself\n"
+  "included.  With a commit-graph the answer comes from the same bitmaps\n"
+  "as is_ancestor_many().");
 
 PyObject *
-Repository_write(Repository *self, PyObject *args)
+Repository_reachable_count(Repository *self, PyObject *py_oid)
 {
-    int err;
     git_oid oid;
-    git_odb *odb;
-    git_odb_stream* stream;
-    int type_id;
-    const char* buffer;
-    Py_ssize_t buflen;
-    git_otype type;
+    git_revwalk *walk;
+    CommitGraph *graph;
+    ReachBitmap *bitmap;
+    uint32_t tip;
+    size_t count = 0;
+    int err;
 
-    if (!PyArg_ParseTuple(args, "Is#", &type_id, &buffer, &buflen))
+    if (py_oid_to_git_oid_expand(self->repo, py_oid, &oid) < 0)
         return NULL;
 
-    type = int_to_loose_object_type(type_id);
-    if (type == GIT_OBJ_BAD)
-        return PyErr_Format(PyExc_ValueError, "%d", type_id);
+    graph = Repository_get_commit_graph(self);
+    if (graph != NULL && commit_graph_find(graph, &oid, &tip)) {
+        bitmap = get_reach_bitmap(graph, tip);
+        commit_graph_decref(graph);
+        if (bitmap == NULL)
+            return NULL;
 
-    err = git_repository_odb(&odb, self->repo);
-    if (err < 0)
-        return Error_set(err);
+        count = bitmap->count;
+        reach_bitmap_decref(bitmap);
+        return PyLong_FromSize_t(count);
+    }
+    commit_graph_decref(graph);
 
-    err = git_odb_open_wstream(&stream, odb, buflen, type);
-    git_odb_free(odb);
+    err = git_revwalk_new(&walk, self->repo);
     if (err < 0)
         return Error_set(err);
 
-    err = git_odb_stream_write(stream, buffer, buflen);
-    if (err) {
-        git_odb_stream_free(stream);
-        return Error_set(err);
+    Py_BEGIN_ALLOW_THREADS
+    err = git_revwalk_push(walk, &oid);
+    if (err == 0) {
+        while ((err = git_revwalk_next(&oid, walk)) == 0)
+            count++;
     }
-
-    err = git_odb_stream_finalize_write(&oid, stream);
-    git_odb_stream_free(stream);
-    if (err)
+    Py_END_ALLOW_THREADS
+    git_revwalk_free(walk);
+    if (err != GIT_ITEROVER)
         return Error_set(err);
 
-    return git_oid_to_python(&oid);
+    return PyLong_FromSize_t(count);
 }
 
-PyDoc_STRVAR(Repository_path__doc__,
-  "The normalized path to the git repository.");
-
-PyObject *
-Repository_path__get__(Repository *self, void *closure)
+static char *
+commit_graph_path(Repository *self, const char *path)
 {
-    return to_path(git_repository_path(self->repo));
+    const char *repo_path;
+    char *buf;
+
+    if (path != NULL) {
+        buf = strdup(path);
+    } else {
+        repo_path = git_repository_path(self->repo);
+        buf = malloc(strlen(repo_path) + strlen(COMMIT_GRAPH_FILE) + 1);
+        if (buf != NULL) {
+            strcpy(buf, repo_path);
+            strcat(buf, COMMIT_GRAPH_FILE);
+        }
+    }
+
+    if (buf == NULL)
+        PyErr_NoMemory();
+
+    return buf;
 }
 
+static void
+Repository_set_commit_graph(Repository *self, CommitGraph *graph)
+{
+    CommitGraph *old = self->graph;
 
-PyDoc_STRVAR(Repository_workdir__doc__,
-  "The normalized path to the working directory of the repository. If the\n"
-  "repository is bare, None will be returned.");
+    self->graph = graph;
+    self->graph_checked = 1;
+    commit_graph_decref(old);
+}
 
-PyObject *
-Repository_workdir__get__(Repository *self, void *closure)
+/* Returns a new reference to the commit-graph of the repository, or NULL
+ * (without an exception set) if there is none.  The default file is looked
+ * for the first time. */
+CommitGraph *
+Repository_get_commit_graph(Repository *self)
 {
-    const char *c_path;
+    CommitGraph *graph;
+    char *path;
+    int err;
 
-    c_path = git_repository_workdir(self->repo);
-    if (c_path == NULL)
-        Py_RETURN_NONE;
+    if (!self->graph_checked) {
+        self->graph_checked = 1;
+        path = commit_graph_path(self, NULL);
+        if (path == NULL) {
+            PyErr_Clear();
+            return NULL;
+        }
 
-    return to_path(c_path);
+        Py_BEGIN_ALLOW_THREADS
+        err = commit_graph_open(&graph, path);
+        Py_END_ALLOW_THREADS
+        free(path);
+
+        /* A missing or unreadable graph just means no acceleration */
+        if (err < 0)
+            giterr_clear();
+        else if (self->graph == NULL)
+            self->graph = graph;
+        else
+            commit_graph_decref(graph);
+    }
+
+    if (self->graph != NULL)
+        commit_graph_incref(self->graph);
+
+    return self->graph;
 }
 
-int
-Repository_workdir__set__(Repository *self, PyObject *py_workdir)
+PyDoc_STRVAR(Repository_write_commit_graph__doc__,
+  "write_commit_graph([path]) -> int\n"
+  "\n"
+  "Write a commit-graph file for every commit reachable from the references\n"
+  "and HEAD, then use it.  It caches the parents, commit times and\n"
+  "generation numbers of the commits, so merge_base() and ahead_behind()\n"
+  "do not have to parse them; commits missing from the graph (because they\n"
+  "are newer) fall back to the object database.  The file is written to\n"
+  "objects/info/pygit2-commit-graph unless path is given, and is loaded\n"
+  "from there automatically.  Returns the number of commits in the graph.");
+
+PyObject *
+Repository_write_commit_graph(Repository *self, PyObject *args)
 {
+    const char *c_path = NULL;
+    char *path;
+    CommitGraph *graph;
+    size_t count;
     int err;
-    const char *workdir;
-    PyObject *tworkdir;
 
-    workdir = py_str_borrow_c_str(&tworkdir, py_workdir, NULL);
-    if (workdir == NULL)
-        return -1;
+    if (!PyArg_ParseTuple(args, "|s", &c_path))
+        return NULL;
 
-    err = git_repository_set_workdir(self->repo, workdir, 0 /* update_gitlink */);
-    Py_DECREF(tworkdir);
+    path = commit_graph_path(self, c_path);
+    if (path == NULL)
+        return NULL;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = commit_graph_write(&count, self->repo, path);
+    if (err == 0)
+        err = commit_graph_open(&graph, path);
+    Py_END_ALLOW_THREADS
     if (err < 0) {
-        Error_set_str(err, workdir);
-        return -1;
+        Error_set_str(err, path);
+        free(path);
+        return NULL;
     }
 
-    return 0;
+    free(path);
+    Repository_set_commit_graph(self, graph);
+    return PyLong_FromSize_t(count);
 }
 
-PyDoc_STRVAR(Repository_merge_base__doc__,
-  "merge_base(oid, oid) -> Oid\n"
+PyDoc_STRVAR(Repository_load_commit_graph__doc__,
+  "load_commit_graph([path]) -> bool\n"
   "\n"
-  "Find as good common ancestors as possible for a merge.");
+  "Use the given commit-graph file, or reload the default one.  Returns\n"
+  "False, and stops using any graph, if the file does not exist.");
 
 PyObject *
-Repository_merge_base(Repository *self, PyObject *args)
+Repository_load_commit_graph(Repository *self, PyObject *args)
 {
-    PyObject *value1;
-    PyObject *value2;
-    git_oid oid;
-    git_oid oid1;
-    git_oid oid2;
+    const char *c_path = NULL;
+    char *path;
+    CommitGraph *graph = NULL;
     int err;
 
-    if (!PyArg_ParseTuple(args, "OO", &value1, &value2))
+    if (!PyArg_ParseTuple(args, "|s", &c_path))
         return NULL;
 
-    err = py_oid_to_git_oid_expand(self->repo, value1, &oid1);
-    if (err < 0)
+    path = commit_graph_path(self, c_path);
+    if (path == NULL)
         return NULL;
 
-    err = py_oid_to_git_oid_expand(self->repo, value2, &oid2);
-    if (err < 0)
+    Py_BEGIN_ALLOW_THREADS
+    err = commit_graph_open(&graph, path);
+    Py_END_ALLOW_THREADS
+    if (err < 0 && err != GIT_ENOTFOUND) {
+        Error_set_str(err, path);
+        free(path);
         return NULL;
+    }
 
-    err = git_merge_base(&oid, self->repo, &oid1, &oid2);
-    if (err < 0)
-        return Error_set(err);
-
-    return git_oid_to_python(&oid);
+    free(path);
+    Repository_set_commit_graph(self, graph);
+    return PyBool_FromLong(graph != NULL);
 }
 
 PyDoc_STRVAR(Repository_merge_analysis__doc__,
@@ -638,9 +1699,11 @@ Repository_merge(Repository *self, PyObject *py_oid)
         return Error_set(err);
 
     checkout_opts.checkout_strategy = GIT_CHECKOUT_SAFE_CREATE;
+    REPOSITORY_BEGIN_ALLOW_THREADS(self)
     err = git_merge(self->repo,
                     (const git_annotated_commit **)&commit, 1,
                     &merge_opts, &checkout_opts);
+    REPOSITORY_END_ALLOW_THREADS(self)
 
     git_annotated_commit_free(commit);
     if (err < 0)
@@ -678,9 +1741,11 @@ Repository_cherrypick(Repository *self, PyObject *py_oid)
         return Error_set(err);
 
     cherrypick_opts.checkout_opts.checkout_strategy = GIT_CHECKOUT_SAFE_CREATE;
+    REPOSITORY_BEGIN_ALLOW_THREADS(self)
     err = git_cherrypick(self->repo,
                     commit,
                     (const git_cherrypick_options *)&cherrypick_opts);
+    REPOSITORY_END_ALLOW_THREADS(self)
 
     git_commit_free(commit);
     if (err < 0)
@@ -716,8 +1781,8 @@ PyDoc_STRVAR(Repository_walk__doc__,
   "  ...    print commit.message\n"
   "  >>>\n");
 
-PyObject *
-Repository_walk(Repository *self, PyObject *args)
+static PyObject *
+new_walker(Repository *self, PyObject *args, int ids_only)
 {
     PyObject *value;
     unsigned int sort = GIT_SORT_NONE;
@@ -760,9 +1825,72 @@ Repository_walk(Repository *self, PyObject *args)
     Py_INCREF(self);
     py_walker->repo = self;
     py_walker->walk = walk;
+    py_walker->ids_only = ids_only;
+    py_walker->paths = NULL;
+    py_walker->paths_size = 0;
     return (PyObject*)py_walker;
 }
 
+PyObject *
+Repository_walk(Repository *self, PyObject *args)
+{
+    return new_walker(self, args, 0);
+}
+
+PyDoc_STRVAR(Repository_walk_ids__doc__,
+  "walk_ids(oid[, sort_mode]) -> iterator\n"
+  "\n"
+  "Like walk(), but the walker yields the ids of the commits instead of the\n"
+  "commits themselves, so the commits are never parsed.  Use\n"
+  "Walker.next_ids() to get them in batches.");
+
+PyObject *
+Repository_walk_ids(Repository *self, PyObject *args)
+{
+    return new_walker(self, args, 1);
+}
+
+PyDoc_STRVAR(Repository_walk_parallel__doc__,
+  "walk_parallel(roots, threads=0, chunk=1000) -> iterator\n"
+  "\n"
+  "Walk the commits reachable from any of the roots on several threads.\n"
+  "The iterator yields batches of commits, as dictionaries of columns like\n"
+  "the one returned by Walker.to_arrays().  Every commit is in exactly one\n"
+  "batch, but neither the batches nor the commits within them come in any\n"
+  "particular order.\n"
+  "\n"
+  "The walk is cut into ranges of about chunk commits along the\n"
+  "first-parent chain of each root (faster with a commit-graph, see\n"
+  "write_commit_graph()).  The ranges are then walked with the GIL\n"
+  "released, by threads threads (the number of CPUs if 0), each thread\n"
+  "taking the next range as soon as it is done with the previous one.");
+
+PyObject *
+Repository_walk_parallel(Repository *self, PyObject *args, PyObject *kw)
+{
+    char *keywords[] = {"roots", "threads", "chunk", NULL};
+    PyObject *py_roots;
+    git_oid *roots;
+    Py_ssize_t n, chunk = 1000;
+    int threads = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kw, "O|in", keywords, &py_roots,
+                                     &threads, &chunk))
+        return NULL;
+
+    if (threads < 0 || chunk < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "threads must be >= 0 and chunk must be >= 1");
+        return NULL;
+    }
+
+    n = py_oid_seq_to_git_oids_expand(self, py_roots, &roots);
+    if (n < 0)
+        return NULL;
+
+    return wrap_parallel_walker(self, roots, n, threads, chunk);
+}
+
 
 PyDoc_STRVAR(Repository_create_blob__doc__,
     "create_blob(data) -> Oid\n"
@@ -781,7 +1909,9 @@ Repository_create_blob(Repository *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s#", &raw, &size))
         return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_blob_create_frombuffer(&oid, self->repo, (const void*)raw, size);
+    Py_END_ALLOW_THREADS
     if (err < 0)
         return Error_set(err);
 
@@ -806,7 +1936,9 @@ Repository_create_blob_fromworkdir(Repository *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s", &path))
         return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_blob_create_fromworkdir(&oid, self->repo, path);
+    Py_END_ALLOW_THREADS
     if (err < 0)
         return Error_set(err);
 
@@ -829,7 +1961,111 @@ Repository_create_blob_fromdisk(Repository *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "s", &path))
         return NULL;
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_blob_create_fromdisk(&oid, self->repo, path);
+    Py_END_ALLOW_THREADS
+    if (err < 0)
+        return Error_set(err);
+
+    return git_oid_to_python(&oid);
+}
+
+
+/*
+ * git_blob_create_fromchunks runs with the GIL released; the callback takes
+ * it back to pull the next chunk out of a Python iterator or file object.
+ */
+typedef struct {
+    PyThreadState *tstate;
+    PyObject *iter;     /* an iterator of buffers... */
+    PyObject *file;     /* ...or an object with a read(size) method */
+    Py_buffer view;     /* the chunk being consumed */
+    int has_view;
+    Py_ssize_t offset;
+    int failed;         /* a Python exception is set */
+} blob_chunks_payload;
+
+static int
+blob_chunks_cb(char *content, size_t max_length, void *payload)
+{
+    blob_chunks_payload *p = (blob_chunks_payload *)payload;
+    PyObject *chunk;
+    size_t len;
+    int ret = 0;
+
+    PyEval_RestoreThread(p->tstate);
+
+    while (!p->has_view || p->offset == p->view.len) {
+        if (p->has_view) {
+            PyBuffer_Release(&p->view);
+            p->has_view = 0;
+        }
+
+        if (p->file != NULL)
+            chunk = PyObject_CallMethod(p->file, "read", "n",
+                                        (Py_ssize_t)ODB_READER_CHUNK_SIZE);
+        else
+            chunk = PyIter_Next(p->iter);
+
+        if (chunk == NULL) {
+            if (PyErr_Occurred())
+                goto error;
+            goto exit; /* end of the iterator */
+        }
+
+        if (PyObject_GetBuffer(chunk, &p->view, PyBUF_SIMPLE) < 0) {
+            Py_DECREF(chunk);
+            goto error;
+        }
+        Py_DECREF(chunk);
+        p->has_view = 1;
+        p->offset = 0;
+
+        if (p->file != NULL && p->view.len == 0)
+            goto exit; /* end of file */
+    }
+
+    len = p->view.len - p->offset;
+    if (len > max_length)
+        len = max_length;
+    memcpy(content, (char *)p->view.buf + p->offset, len);
+    p->offset += len;
+    ret = (int)len;
+    goto exit;
+
+error:
+    p->failed = 1;
+    ret = GIT_EUSER;
+
+exit:
+    p->tstate = PyEval_SaveThread();
+    return ret;
+}
+
+static PyObject *
+create_blob_fromchunks(Repository *self, PyObject *iter, PyObject *file,
+                       const char *hintpath)
+{
+    blob_chunks_payload payload;
+    git_oid oid;
+    int err;
+
+    payload.iter = iter;
+    payload.file = file;
+    payload.has_view = 0;
+    payload.offset = 0;
+    payload.failed = 0;
+
+    payload.tstate = PyEval_SaveThread();
+    err = git_blob_create_fromchunks(&oid, self->repo, hintpath,
+                                     blob_chunks_cb, &payload);
+    PyEval_RestoreThread(payload.tstate);
+
+    if (payload.has_view)
+        PyBuffer_Release(&payload.view);
+
+    if (payload.failed)
+        return NULL;
     if (err < 0)
         return Error_set(err);
 
@@ -837,6 +2073,52 @@ Repository_create_blob_fromdisk(Repository *self, PyObject *args)
 }
 
 
+PyDoc_STRVAR(Repository_create_blob_fromiter__doc__,
+    "create_blob_fromiter(iterable[, hintpath]) -> Oid\n"
+    "\n"
+    "Create a new blob from an iterable of bytes strings (or any objects\n"
+    "supporting the buffer interface), without joining them in memory. If\n"
+    "hintpath is given, the filters configured for that path are applied.");
+
+PyObject *
+Repository_create_blob_fromiter(Repository *self, PyObject *args)
+{
+    PyObject *py_iterable, *iter, *py_result;
+    const char *hintpath = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|z", &py_iterable, &hintpath))
+        return NULL;
+
+    iter = PyObject_GetIter(py_iterable);
+    if (iter == NULL)
+        return NULL;
+
+    py_result = create_blob_fromchunks(self, iter, NULL, hintpath);
+    Py_DECREF(iter);
+    return py_result;
+}
+
+
+PyDoc_STRVAR(Repository_create_blob_fromfile__doc__,
+    "create_blob_fromfile(file[, hintpath]) -> Oid\n"
+    "\n"
+    "Create a new blob from a readable file-like object, reading it in\n"
+    "chunks until read() returns an empty string. If hintpath is given, the\n"
+    "filters configured for that path are applied.");
+
+PyObject *
+Repository_create_blob_fromfile(Repository *self, PyObject *args)
+{
+    PyObject *py_file;
+    const char *hintpath = NULL;
+
+    if (!PyArg_ParseTuple(args, "O|z", &py_file, &hintpath))
+        return NULL;
+
+    return create_blob_fromchunks(self, NULL, py_file, hintpath);
+}
+
+
 PyDoc_STRVAR(Repository_create_commit__doc__,
   "create_commit(reference_name, author, committer, message, tree, parents[, encoding]) -> Oid\n"
   "\n"
@@ -1254,9 +2536,13 @@ Repository_status(Repository *self)
     if (dict == NULL)
         return NULL;
 
+    REPOSITORY_BEGIN_ALLOW_THREADS(self)
     err = git_status_list_new(&list, self->repo, NULL);
-    if (err < 0)
+    REPOSITORY_END_ALLOW_THREADS(self)
+    if (err < 0) {
+        Py_DECREF(dict);
         return Error_set(err);
+    }
 
     len = git_status_list_entrycount(list);
     for (i = 0; i < len; i++) {
@@ -1309,12 +2595,15 @@ Repository_status_file(Repository *self, PyObject *value)
     if (!path)
         return NULL;
 
+    REPOSITORY_BEGIN_ALLOW_THREADS(self)
     err = git_status_file(&status, self->repo, path);
+    REPOSITORY_END_ALLOW_THREADS(self)
     if (err < 0) {
         PyObject *err_obj =  Error_set_str(err, path);
         free(path);
         return err_obj;
     }
+    free(path);
     return PyLong_FromLong(status);
 }
 
@@ -1375,6 +2664,19 @@ Repository_TreeBuilder(Repository *self, PyObject *args)
     return (PyObject*)builder;
 }
 
+PyDoc_STRVAR(Repository_PackWriter__doc__,
+  "PackWriter() -> PackWriter\n"
+  "\n"
+  "Create a PackWriter, to add many objects to the repository as a single\n"
+  "pack instead of one loose file each.");
+
+PyObject *
+Repository_PackWriter(Repository *self)
+{
+    return wrap_pack_writer(self);
+}
+
+
 PyDoc_STRVAR(Repository_default_signature__doc__, "Return the signature according to the repository's configuration");
 
 PyObject *
@@ -1513,7 +2815,11 @@ Repository_reset(Repository *self, PyObject* args)
 
     err = git_object_lookup_prefix(&target, self->repo, &oid, len,
                                    GIT_OBJ_ANY);
-    err = err < 0 ? err : git_reset(self->repo, target, reset_type, NULL, NULL, NULL);
+    if (err == 0) {
+        REPOSITORY_BEGIN_ALLOW_THREADS(self)
+        err = git_reset(self->repo, target, reset_type, NULL, NULL, NULL);
+        REPOSITORY_END_ALLOW_THREADS(self)
+    }
     git_object_free(target);
     if (err < 0)
         return Error_set_oid(err, &oid, len);
@@ -1542,15 +2848,32 @@ PyMethodDef Repository_methods[] = {
     METHOD(Repository, create_blob, METH_VARARGS),
     METHOD(Repository, create_blob_fromworkdir, METH_VARARGS),
     METHOD(Repository, create_blob_fromdisk, METH_VARARGS),
+    METHOD(Repository, create_blob_fromiter, METH_VARARGS),
+    METHOD(Repository, create_blob_fromfile, METH_VARARGS),
     METHOD(Repository, create_commit, METH_VARARGS),
     METHOD(Repository, create_tag, METH_VARARGS),
     METHOD(Repository, TreeBuilder, METH_VARARGS),
+    METHOD(Repository, PackWriter, METH_NOARGS),
     METHOD(Repository, walk, METH_VARARGS),
+    METHOD(Repository, walk_ids, METH_VARARGS),
+    METHOD(Repository, walk_parallel, METH_VARARGS | METH_KEYWORDS),
     METHOD(Repository, merge_base, METH_VARARGS),
+    METHOD(Repository, write_commit_graph, METH_VARARGS),
+    METHOD(Repository, load_commit_graph, METH_VARARGS),
+    METHOD(Repository, is_ancestor_many, METH_VARARGS),
+    METHOD(Repository, reachable_count, METH_O),
+    METHOD(Repository, merge_base_batch, METH_VARARGS),
+    METHOD(Repository, ahead_behind_batch, METH_VARARGS),
+    METHOD(Repository, _ahead_behind_graph, METH_VARARGS),
     METHOD(Repository, merge_analysis, METH_O),
     METHOD(Repository, merge, METH_O),
     METHOD(Repository, cherrypick, METH_O),
     METHOD(Repository, read, METH_O),
+    METHOD(Repository, read_buffer, METH_O),
+    METHOD(Repository, open_reader, METH_VARARGS),
+    METHOD(Repository, iter_objects, METH_VARARGS),
+    METHOD(Repository, read_many, METH_O),
+    METHOD(Repository, lookup_many, METH_O),
     METHOD(Repository, write, METH_VARARGS),
     METHOD(Repository, create_reference_direct, METH_VARARGS),
     METHOD(Repository, create_reference_symbolic, METH_VARARGS),
@@ -1571,6 +2894,8 @@ PyMethodDef Repository_methods[] = {
     METHOD(Repository, expand_id, METH_O),
     METHOD(Repository, _from_c, METH_VARARGS),
     METHOD(Repository, _disown, METH_NOARGS),
+    METHOD(Repository, _lock, METH_NOARGS),
+    METHOD(Repository, _unlock, METH_NOARGS),
     {NULL}
 };
 
@@ -1582,6 +2907,8 @@ PyGetSetDef Repository_getseters[] = {
     GETTER(Repository, is_empty),
     GETTER(Repository, is_bare),
     GETSET(Repository, workdir),
+    GETSET(Repository, object_cache_size),
+    GETTER(Repository, object_cache_stats),
     GETTER(Repository, default_signature),
     GETTER(Repository, _pointer),
     {NULL}
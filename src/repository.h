@@ -35,6 +35,8 @@
 
 PyObject *wrap_repository(git_repository *c_repo);
 
+git_otype int_to_loose_object_type(int type_id);
+
 int  Repository_init(Repository *self, PyObject *args, PyObject *kwds);
 int  Repository_traverse(Repository *self, visitproc visit, void *arg);
 int  Repository_clear(Repository *self);
@@ -46,13 +48,29 @@ Repository_read_raw(git_repository *repo, const git_oid *oid, size_t len);
 PyObject* Repository_head(Repository *self);
 PyObject* Repository_getitem(Repository *self, PyObject *value);
 PyObject* Repository_read(Repository *self, PyObject *py_hex);
+PyObject* Repository_read_buffer(Repository *self, PyObject *py_hex);
+PyObject* Repository_open_reader(Repository *self, PyObject *args);
+PyObject* Repository_read_many(Repository *self, PyObject *py_oids);
+PyObject* Repository_lookup_many(Repository *self, PyObject *py_oids);
 PyObject* Repository_write(Repository *self, PyObject *args);
 PyObject* Repository_get_index(Repository *self, void *closure);
 PyObject* Repository_get_path(Repository *self, void *closure);
 PyObject* Repository_get_workdir(Repository *self, void *closure);
 PyObject* Repository_get_config(Repository *self, void *closure);
 PyObject* Repository_walk(Repository *self, PyObject *args);
+PyObject* Repository_write_commit_graph(Repository *self, PyObject *args);
+PyObject* Repository_load_commit_graph(Repository *self, PyObject *args);
+PyObject* Repository__ahead_behind_graph(Repository *self, PyObject *args);
+PyObject* Repository_is_ancestor_many(Repository *self, PyObject *args);
+PyObject* Repository_reachable_count(Repository *self, PyObject *py_oid);
+PyObject* Repository_merge_base_batch(Repository *self, PyObject *args);
+PyObject* Repository_ahead_behind_batch(Repository *self, PyObject *args);
+CommitGraph* Repository_get_commit_graph(Repository *self);
+PyObject* Repository_walk_ids(Repository *self, PyObject *args);
+PyObject* Repository_walk_parallel(Repository *self, PyObject *args,
+                                   PyObject *kw);
 PyObject* Repository_create_blob(Repository *self, PyObject *args);
+PyObject* Repository_create_blob_fromiter(Repository *self, PyObject *args);
 PyObject* Repository_create_blob_fromfile(Repository *self, PyObject *args);
 PyObject* Repository_create_commit(Repository *self, PyObject *args);
 PyObject* Repository_create_tag(Repository *self, PyObject *args);
@@ -68,6 +86,7 @@ PyObject* Repository_packall_references(Repository *self,  PyObject *args);
 PyObject* Repository_status(Repository *self);
 PyObject* Repository_status_file(Repository *self, PyObject *value);
 PyObject* Repository_TreeBuilder(Repository *self, PyObject *args);
+PyObject* Repository_PackWriter(Repository *self);
 
 PyObject* Repository_blame(Repository *self, PyObject *args, PyObject *kwds);
 
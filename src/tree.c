@@ -39,12 +39,16 @@ extern PyTypeObject TreeType;
 extern PyTypeObject TreeEntryType;
 extern PyTypeObject DiffType;
 extern PyTypeObject TreeIterType;
+extern PyTypeObject TreeWalkIterType;
 extern PyTypeObject IndexType;
 
 void
 TreeEntry_dealloc(TreeEntry *self)
 {
-    git_tree_entry_free((git_tree_entry*)self->entry);
+    if (self->owner != NULL)
+        Py_DECREF(self->owner);
+    else
+        git_tree_entry_free((git_tree_entry*)self->entry);
     PyObject_Del(self);
 }
 
@@ -241,15 +245,23 @@ Tree_contains(Tree *self, PyObject *py_name)
     return 1;
 }
 
+/* With an owner the entry is borrowed from its tree, otherwise the new
+ * TreeEntry takes the entry over, and frees it even on failure */
 TreeEntry *
-wrap_tree_entry(const git_tree_entry *entry)
+wrap_tree_entry(const git_tree_entry *entry, Tree *owner)
 {
     TreeEntry *py_entry;
 
     py_entry = PyObject_New(TreeEntry, &TreeEntryType);
-    if (py_entry)
-        py_entry->entry = entry;
+    if (py_entry == NULL) {
+        if (owner == NULL)
+            git_tree_entry_free((git_tree_entry*)entry);
+        return NULL;
+    }
 
+    py_entry->entry = entry;
+    py_entry->owner = owner;
+    Py_XINCREF(owner);
     return py_entry;
 }
 
@@ -300,31 +312,26 @@ TreeEntry *
 Tree_getitem_by_index(Tree *self, PyObject *py_index)
 {
     int index;
-    const git_tree_entry *entry_src;
-    git_tree_entry *entry;
+    const git_tree_entry *entry;
 
     index = Tree_fix_index(self, py_index);
     if (PyErr_Occurred())
         return NULL;
 
-    entry_src = git_tree_entry_byindex(self->tree, index);
-    if (!entry_src) {
+    entry = git_tree_entry_byindex(self->tree, index);
+    if (!entry) {
         PyErr_SetObject(PyExc_IndexError, py_index);
         return NULL;
     }
 
-    if (git_tree_entry_dup(&entry, entry_src) < 0) {
-        PyErr_SetNone(PyExc_MemoryError);
-        return NULL;
-    }
-
-    return wrap_tree_entry(entry);
+    return wrap_tree_entry(entry, self);
 }
 
 TreeEntry *
 Tree_getitem(Tree *self, PyObject *value)
 {
     char *path;
+    const git_tree_entry *entry_src;
     git_tree_entry *entry;
     int err;
 
@@ -337,6 +344,18 @@ Tree_getitem(Tree *self, PyObject *value)
     if (path == NULL)
         return NULL;
 
+    /* A name in this tree, borrow the entry */
+    if (strchr(path, '/') == NULL) {
+        entry_src = git_tree_entry_byname(self->tree, path);
+        free(path);
+        if (entry_src == NULL) {
+            PyErr_SetObject(PyExc_KeyError, value);
+            return NULL;
+        }
+
+        return wrap_tree_entry(entry_src, self);
+    }
+
     err = git_tree_entry_bypath(&entry, self->tree, path);
     free(path);
 
@@ -348,8 +367,8 @@ Tree_getitem(Tree *self, PyObject *value)
     if (err < 0)
         return (TreeEntry*)Error_set(err);
 
-    /* git_tree_entry_dup is already done in git_tree_entry_bypath */
-    return wrap_tree_entry(entry);
+    /* The entry may be in a subtree, git_tree_entry_bypath made a copy */
+    return wrap_tree_entry(entry, NULL);
 }
 
 
@@ -381,7 +400,9 @@ Tree_diff_to_workdir(Tree *self, PyObject *args)
         return NULL;
 
     py_repo = self->repo;
+    REPOSITORY_BEGIN_ALLOW_THREADS(py_repo)
     err = git_diff_tree_to_workdir(&diff, py_repo->repo, self->tree, &opts);
+    REPOSITORY_END_ALLOW_THREADS(py_repo)
     if (err < 0)
         return Error_set(err);
 
@@ -449,7 +470,9 @@ Tree_diff_to_index(Tree *self, PyObject *args, PyObject *kwds)
     index = *((git_index **) buffer);
 
     py_repo = self->repo;
+    REPOSITORY_BEGIN_ALLOW_THREADS(py_repo)
     err = git_diff_tree_to_index(&diff, py_repo->repo, self->tree, index, &opts);
+    REPOSITORY_END_ALLOW_THREADS(py_repo)
     if (err < 0)
         return Error_set(err);
 
@@ -505,7 +528,9 @@ Tree_diff_to_tree(Tree *self, PyObject *args, PyObject *kwds)
         to = tmp;
     }
 
+    Py_BEGIN_ALLOW_THREADS
     err = git_diff_tree_to_tree(&diff, py_repo->repo, from, to, &opts);
+    Py_END_ALLOW_THREADS
     if (err < 0)
         return Error_set(err);
 
@@ -513,6 +538,397 @@ Tree_diff_to_tree(Tree *self, PyObject *args, PyObject *kwds)
 }
 
 
+PyDoc_STRVAR(Tree_entries_as_tuples__doc__,
+  "entries_as_tuples() -> [(name, oid, filemode), ...]\n"
+  "\n"
+  "Return the entries of the tree, in order, as tuples.  Faster than\n"
+  "iterating over the tree when only these values are needed.");
+
+PyObject *
+Tree_entries_as_tuples(Tree *self)
+{
+    const git_tree_entry *entry;
+    PyObject *list, *tuple;
+    size_t i, n;
+
+    n = git_tree_entrycount(self->tree);
+    list = PyList_New(n);
+    if (list == NULL)
+        return NULL;
+
+    for (i = 0; i < n; i++) {
+        entry = git_tree_entry_byindex(self->tree, i);
+        tuple = Py_BuildValue("(NNi)",
+                              to_path(git_tree_entry_name(entry)),
+                              git_oid_to_python(git_tree_entry_id(entry)),
+                              git_tree_entry_filemode(entry));
+        if (tuple == NULL) {
+            Py_DECREF(list);
+            return NULL;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+    return list;
+}
+
+
+PyDoc_STRVAR(Tree_walk__doc__,
+  "walk([mode, paths, batch]) -> iterator\n"
+  "\n"
+  "Walk the tree recursively, yielding lists of up to batch (1000 by\n"
+  "default) (path, oid, filemode) tuples.  Paths are relative to this\n"
+  "tree, and subtrees are yielded too.\n"
+  "\n"
+  "Arguments:\n"
+  "\n"
+  "mode: GIT_TREEWALK_PRE (the default) yields a subtree before its\n"
+  "   entries, GIT_TREEWALK_POST after them.\n"
+  "\n"
+  "paths: a list of pathspecs (like 'src/*.c'), only the entries matching\n"
+  "   one of them are yielded.  The subtrees that cannot hold a match,\n"
+  "   going by the pathspecs up to their first wildcard, are not loaded.\n"
+  "\n"
+  "The subtrees are loaded with the GIL released.");
+
+PyObject *
+Tree_walk(Tree *self, PyObject *args, PyObject *kwds)
+{
+    char *keywords[] = {"mode", "paths", "batch", NULL};
+    TreeWalkIter *iter;
+    PyObject *py_paths = Py_None;
+    git_strarray paths = {NULL, 0};
+    Py_ssize_t batch = 1000;
+    int mode = GIT_TREEWALK_PRE;
+    size_t i, len, size = 0;
+    const char *spec;
+    int err;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|iOn", keywords, &mode,
+                                     &py_paths, &batch))
+        return NULL;
+
+    if (mode != GIT_TREEWALK_PRE && mode != GIT_TREEWALK_POST) {
+        PyErr_SetString(PyExc_ValueError, "invalid walk mode");
+        return NULL;
+    }
+
+    if (batch < 1) {
+        PyErr_SetString(PyExc_ValueError, "batch must be >= 1");
+        return NULL;
+    }
+
+    if (py_paths != Py_None &&
+        get_strarraygit_from_pylist(&paths, py_paths) < 0)
+        return NULL;
+
+    iter = PyObject_New(TreeWalkIter, &TreeWalkIterType);
+    if (iter == NULL) {
+        git_strarray_free(&paths);
+        return NULL;
+    }
+
+    Py_INCREF(self);
+    iter->owner = self;
+    iter->mode = mode;
+    iter->batch = batch;
+    iter->pathspec = NULL;
+    iter->prefixes = NULL;
+    iter->n_prefixes = 0;
+    iter->stack = NULL;
+    iter->depth = 0;
+    iter->stack_alloc = 0;
+    iter->busy = 0;
+    iter->path = NULL;
+    iter->path_alloc = 0;
+    iter->paths = NULL;
+    iter->paths_size = 0;
+    iter->paths_alloc = 0;
+    iter->path_starts = NULL;
+    iter->oids = NULL;
+    iter->modes = NULL;
+    iter->n = 0;
+
+    err = 0;
+    if (py_paths != Py_None) {
+        err = git_pathspec_new(&iter->pathspec, &paths);
+        if (err < 0)
+            goto error;
+
+        /* The literal start of every pattern, for pruning */
+        for (i = 0; i < paths.count; i++)
+            size += strlen(paths.strings[i]) + 1;
+        MALLOC(iter->prefixes, size ? size : 1, error);
+
+        size = 0;
+        for (i = 0; i < paths.count; i++) {
+            spec = paths.strings[i];
+            len = (spec[0] == '!' || spec[0] == ':') ? 0 :
+                  strcspn(spec, "*?[\\");
+            memcpy(iter->prefixes + size, spec, len);
+            size += len;
+            iter->prefixes[size++] = '\0';
+        }
+        iter->n_prefixes = paths.count;
+    }
+
+    iter->stack_alloc = 16;
+    iter->path_alloc = 256;
+    CALLOC(iter->stack, iter->stack_alloc, sizeof(TreeWalkFrame), error);
+    MALLOC(iter->path, iter->path_alloc, error);
+    CALLOC(iter->path_starts, iter->batch, sizeof(size_t), error);
+    CALLOC(iter->oids, iter->batch, sizeof(git_oid), error);
+    CALLOC(iter->modes, iter->batch, sizeof(git_filemode_t), error);
+
+    iter->stack[0].tree = self->tree;
+    iter->stack[0].i = 0;
+    iter->stack[0].path_len = 0;
+    iter->stack[0].entry = NULL;
+    iter->depth = 1;
+
+    git_strarray_free(&paths);
+    return (PyObject*)iter;
+
+error:
+    git_strarray_free(&paths);
+    Py_DECREF(iter);
+    return Error_set(err);
+}
+
+
+/* A path found by Tree.changed_paths(), missing ids are all zeros */
+typedef struct {
+    size_t path;                     /* Offset into ChangedPaths.paths */
+    git_oid old_id;
+    git_oid new_id;
+    int has_old;
+    int has_new;
+} ChangedPath;
+
+typedef struct {
+    git_repository *repo;
+    char *path;                      /* The path being compared */
+    size_t path_alloc;
+    char *paths;                     /* Of the changes, nul-terminated */
+    size_t paths_size;
+    size_t paths_alloc;
+    ChangedPath *changes;
+    size_t n;
+    size_t alloc;
+} ChangedPaths;
+
+static int
+changed_paths_append(ChangedPaths *cp, size_t len,
+                     const git_tree_entry *old, const git_tree_entry *new)
+{
+    ChangedPath *change;
+    size_t alloc;
+    char *ptr;
+
+    if (cp->n == cp->alloc) {
+        alloc = cp->alloc ? cp->alloc * 2 : 64;
+        change = realloc(cp->changes, alloc * sizeof(ChangedPath));
+        if (change == NULL)
+            goto oom;
+        cp->changes = change;
+        cp->alloc = alloc;
+    }
+
+    if (cp->paths_size + len + 1 > cp->paths_alloc) {
+        alloc = cp->paths_alloc ? cp->paths_alloc : 4096;
+        while (alloc < cp->paths_size + len + 1)
+            alloc *= 2;
+        ptr = realloc(cp->paths, alloc);
+        if (ptr == NULL)
+            goto oom;
+        cp->paths = ptr;
+        cp->paths_alloc = alloc;
+    }
+
+    change = &cp->changes[cp->n++];
+    change->path = cp->paths_size;
+    memcpy(cp->paths + cp->paths_size, cp->path, len);
+    cp->paths_size += len;
+    cp->paths[cp->paths_size++] = '\0';
+
+    change->has_old = (old != NULL);
+    change->has_new = (new != NULL);
+    memset(&change->old_id, 0, sizeof(git_oid));
+    memset(&change->new_id, 0, sizeof(git_oid));
+    if (old != NULL)
+        git_oid_cpy(&change->old_id, git_tree_entry_id(old));
+    if (new != NULL)
+        git_oid_cpy(&change->new_id, git_tree_entry_id(new));
+    return 0;
+
+oom:
+    giterr_set_oom();
+    return GIT_ERROR;
+}
+
+static int changed_paths_trees(ChangedPaths *cp, size_t len,
+                               const git_oid *old, const git_oid *new);
+
+/* Compares two entries with the same name, either may be missing */
+static int
+changed_paths_entries(ChangedPaths *cp, size_t dir_len,
+                      const git_tree_entry *old, const git_tree_entry *new)
+{
+    const git_tree_entry *entry = (old != NULL) ? old : new;
+    const char *name = git_tree_entry_name(entry);
+    size_t len = dir_len + strlen(name), alloc;
+    int old_tree, new_tree;
+    char *ptr;
+
+    if (old != NULL && new != NULL &&
+        git_oid_equal(git_tree_entry_id(old), git_tree_entry_id(new)) &&
+        git_tree_entry_filemode(old) == git_tree_entry_filemode(new))
+        return 0;
+
+    if (len + 2 > cp->path_alloc) {
+        alloc = cp->path_alloc ? cp->path_alloc * 2 : 256;
+        while (alloc < len + 2)
+            alloc *= 2;
+        ptr = realloc(cp->path, alloc);
+        if (ptr == NULL) {
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+        cp->path = ptr;
+        cp->path_alloc = alloc;
+    }
+    strcpy(cp->path + dir_len, name);
+
+    /* git_tree_entry_cmp() tells trees apart, so both sides are trees or
+     * neither is */
+    old_tree = old != NULL && git_tree_entry_type(old) == GIT_OBJ_TREE;
+    new_tree = new != NULL && git_tree_entry_type(new) == GIT_OBJ_TREE;
+    if (old_tree || new_tree) {
+        cp->path[len] = '/';
+        return changed_paths_trees(cp, len + 1,
+                                   old ? git_tree_entry_id(old) : NULL,
+                                   new ? git_tree_entry_id(new) : NULL);
+    }
+
+    return changed_paths_append(cp, len, old, new);
+}
+
+/* Merge-joins the sorted entries of two trees, either may be missing */
+static int
+changed_paths_trees(ChangedPaths *cp, size_t len, const git_oid *old_id,
+                    const git_oid *new_id)
+{
+    git_tree *old = NULL, *new = NULL;
+    const git_tree_entry *a, *b;
+    size_t i = 0, j = 0;
+    int cmp, err = 0;
+
+    if (old_id != NULL && new_id != NULL && git_oid_equal(old_id, new_id))
+        return 0;
+
+    if (old_id != NULL && (err = git_tree_lookup(&old, cp->repo, old_id)) < 0)
+        goto exit;
+    if (new_id != NULL && (err = git_tree_lookup(&new, cp->repo, new_id)) < 0)
+        goto exit;
+
+    for (;;) {
+        a = (old != NULL) ? git_tree_entry_byindex(old, i) : NULL;
+        b = (new != NULL) ? git_tree_entry_byindex(new, j) : NULL;
+        if (a == NULL && b == NULL)
+            break;
+
+        cmp = (a == NULL) ? 1 : (b == NULL) ? -1 : git_tree_entry_cmp(a, b);
+        if (cmp < 0) {
+            err = changed_paths_entries(cp, len, a, NULL);
+            i++;
+        } else if (cmp > 0) {
+            err = changed_paths_entries(cp, len, NULL, b);
+            j++;
+        } else {
+            err = changed_paths_entries(cp, len, a, b);
+            i++;
+            j++;
+        }
+        if (err < 0)
+            break;
+    }
+
+exit:
+    git_tree_free(old);
+    git_tree_free(new);
+    return err;
+}
+
+static PyObject *
+changed_path_id(const ChangedPath *change, int old)
+{
+    if (old ? !change->has_old : !change->has_new)
+        Py_RETURN_NONE;
+
+    return git_oid_to_python(old ? &change->old_id : &change->new_id);
+}
+
+PyDoc_STRVAR(Tree_changed_paths__doc__,
+  "changed_paths([tree]) -> [(path, old_oid, new_oid), ...]\n"
+  "\n"
+  "Return the paths of the files that differ between this tree and the\n"
+  "given one (the empty tree if None), in tree order.  The old oid is None\n"
+  "for added files, the new oid is None for deleted files.\n"
+  "\n"
+  "Unlike diff_to_tree(), this only compares the ids of the tree entries,\n"
+  "and only loads the subtrees whose ids differ.  There is no rename\n"
+  "detection, and a file replaced by a directory (or the other way\n"
+  "round) shows as deleted and added.");
+
+PyObject *
+Tree_changed_paths(Tree *self, PyObject *args)
+{
+    ChangedPaths cp;
+    ChangedPath *change;
+    Tree *py_tree = NULL;
+    PyObject *list = NULL, *tuple;
+    size_t i;
+    int err;
+
+    if (!PyArg_ParseTuple(args, "|O!", &TreeType, &py_tree))
+        return NULL;
+
+    memset(&cp, 0, sizeof(cp));
+    cp.repo = self->repo->repo;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = changed_paths_trees(&cp, 0, git_tree_id(self->tree),
+                              py_tree ? git_tree_id(py_tree->tree) : NULL);
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    list = PyList_New(cp.n);
+    if (list == NULL)
+        goto exit;
+
+    for (i = 0; i < cp.n; i++) {
+        change = &cp.changes[i];
+        tuple = Py_BuildValue("(NNN)", to_path(cp.paths + change->path),
+                              changed_path_id(change, 1),
+                              changed_path_id(change, 0));
+        if (tuple == NULL) {
+            Py_CLEAR(list);
+            goto exit;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+exit:
+    free(cp.path);
+    free(cp.paths);
+    free(cp.changes);
+    return list;
+}
+
+
 PySequenceMethods Tree_as_sequence = {
     0,                          /* sq_length */
     0,                          /* sq_concat */
@@ -531,9 +947,12 @@ PyMappingMethods Tree_as_mapping = {
 };
 
 PyMethodDef Tree_methods[] = {
+    METHOD(Tree, changed_paths, METH_VARARGS),
     METHOD(Tree, diff_to_tree, METH_VARARGS | METH_KEYWORDS),
     METHOD(Tree, diff_to_workdir, METH_VARARGS),
     METHOD(Tree, diff_to_index, METH_VARARGS | METH_KEYWORDS),
+    METHOD(Tree, entries_as_tuples, METH_NOARGS),
+    METHOD(Tree, walk, METH_VARARGS | METH_KEYWORDS),
     {NULL}
 };
 
@@ -592,20 +1011,14 @@ TreeIter_dealloc(TreeIter *self)
 TreeEntry *
 TreeIter_iternext(TreeIter *self)
 {
-    const git_tree_entry *entry_src;
-    git_tree_entry *entry;
+    const git_tree_entry *entry;
 
-    entry_src = git_tree_entry_byindex(self->owner->tree, self->i);
-    if (!entry_src)
+    entry = git_tree_entry_byindex(self->owner->tree, self->i);
+    if (!entry)
         return NULL;
 
     self->i += 1;
-
-    if (git_tree_entry_dup(&entry, entry_src) < 0) {
-        PyErr_SetNone(PyExc_MemoryError);
-        return NULL;
-    }
-    return wrap_tree_entry(entry);
+    return wrap_tree_entry(entry, self->owner);
 }
 
 
@@ -640,3 +1053,260 @@ PyTypeObject TreeIterType = {
     PyObject_SelfIter,                         /* tp_iter           */
     (iternextfunc)TreeIter_iternext,           /* tp_iternext       */
 };
+
+
+void
+TreeWalkIter_dealloc(TreeWalkIter *self)
+{
+    /* The first tree is the owner's */
+    while (self->depth > 1)
+        git_tree_free(self->stack[--self->depth].tree);
+
+    git_pathspec_free(self->pathspec);
+    free(self->prefixes);
+    free(self->stack);
+    free(self->path);
+    free(self->paths);
+    free(self->path_starts);
+    free(self->oids);
+    free(self->modes);
+    Py_CLEAR(self->owner);
+    PyObject_Del(self);
+}
+
+/* Whether a directory (its path ends with a slash) may hold a match */
+static int
+TreeWalkIter_may_match(TreeWalkIter *self, const char *dir, size_t len)
+{
+    const char *prefix = self->prefixes;
+    size_t i, n;
+
+    if (self->pathspec == NULL)
+        return 1;
+
+    for (i = 0; i < self->n_prefixes; i++, prefix += n + 1) {
+        n = strlen(prefix);
+        if (strncmp(dir, prefix, n < len ? n : len) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Adds self->path[0:len] to the batch, if it matches */
+static int
+TreeWalkIter_yield(TreeWalkIter *self, size_t len,
+                   const git_tree_entry *entry)
+{
+    size_t alloc;
+    char *ptr, c;
+    int match;
+
+    if (self->pathspec != NULL) {
+        c = self->path[len];
+        self->path[len] = '\0';
+        match = git_pathspec_matches_path(self->pathspec, 0, self->path);
+        self->path[len] = c;
+        if (!match)
+            return 0;
+    }
+
+    if (self->paths_size + len + 1 > self->paths_alloc) {
+        alloc = self->paths_alloc ? self->paths_alloc : 4096;
+        while (alloc < self->paths_size + len + 1)
+            alloc *= 2;
+
+        ptr = realloc(self->paths, alloc);
+        if (ptr == NULL) {
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+        self->paths = ptr;
+        self->paths_alloc = alloc;
+    }
+
+    self->path_starts[self->n] = self->paths_size;
+    memcpy(self->paths + self->paths_size, self->path, len);
+    self->paths_size += len;
+    self->paths[self->paths_size++] = '\0';
+    git_oid_cpy(&self->oids[self->n], git_tree_entry_id(entry));
+    self->modes[self->n] = git_tree_entry_filemode(entry);
+    self->n++;
+    return 0;
+}
+
+/* Fills the next batch.  Does not need the GIL. */
+static int
+TreeWalkIter_fill(TreeWalkIter *self)
+{
+    TreeWalkFrame *frame, *ptr;
+    const git_tree_entry *entry;
+    const char *name;
+    git_tree *tree;
+    size_t len, alloc;
+    char *path;
+    int err;
+
+    while (self->n < self->batch && self->depth > 0) {
+        frame = &self->stack[self->depth - 1];
+        entry = git_tree_entry_byindex(frame->tree, frame->i);
+
+        /* Done with this tree */
+        if (entry == NULL) {
+            if (frame->entry != NULL) {
+                err = TreeWalkIter_yield(self, frame->path_len - 1,
+                                         frame->entry);
+                if (err < 0)
+                    return err;
+            }
+            if (self->depth > 1)
+                git_tree_free(frame->tree);
+            self->depth--;
+            continue;
+        }
+        frame->i++;
+
+        name = git_tree_entry_name(entry);
+        len = frame->path_len + strlen(name);
+        if (len + 2 > self->path_alloc) {
+            alloc = self->path_alloc * 2;
+            while (alloc < len + 2)
+                alloc *= 2;
+
+            path = realloc(self->path, alloc);
+            if (path == NULL) {
+                giterr_set_oom();
+                return GIT_ERROR;
+            }
+            self->path = path;
+            self->path_alloc = alloc;
+        }
+        strcpy(self->path + frame->path_len, name);
+
+        if (git_tree_entry_type(entry) == GIT_OBJ_TREE) {
+            self->path[len] = '/';
+            if (TreeWalkIter_may_match(self, self->path, len + 1)) {
+                if (self->mode == GIT_TREEWALK_PRE) {
+                    err = TreeWalkIter_yield(self, len, entry);
+                    if (err < 0)
+                        return err;
+                }
+
+                err = git_tree_lookup(&tree, git_tree_owner(frame->tree),
+                                      git_tree_entry_id(entry));
+                if (err < 0)
+                    return err;
+
+                if (self->depth == self->stack_alloc) {
+                    alloc = self->stack_alloc * 2;
+                    ptr = realloc(self->stack, alloc * sizeof(TreeWalkFrame));
+                    if (ptr == NULL) {
+                        git_tree_free(tree);
+                        giterr_set_oom();
+                        return GIT_ERROR;
+                    }
+                    self->stack = ptr;
+                    self->stack_alloc = alloc;
+                }
+
+                /* The frame may have moved, but not the entry */
+                frame = &self->stack[self->depth++];
+                frame->tree = tree;
+                frame->i = 0;
+                frame->path_len = len + 1;
+                frame->entry = (self->mode == GIT_TREEWALK_POST) ? entry
+                                                                  : NULL;
+                continue;
+            }
+        }
+
+        err = TreeWalkIter_yield(self, len, entry);
+        if (err < 0)
+            return err;
+    }
+
+    return 0;
+}
+
+PyObject *
+TreeWalkIter_iternext(TreeWalkIter *self)
+{
+    PyObject *list = NULL, *tuple;
+    size_t i;
+    int err;
+
+    /* The batch buffers are shared by every caller of this iterator */
+    if (self->busy) {
+        PyErr_SetString(PyExc_ValueError, "tree walk already executing");
+        return NULL;
+    }
+    self->busy = 1;
+
+    self->n = 0;
+    self->paths_size = 0;
+
+    /* Only loads trees, which does not need the repository lock */
+    Py_BEGIN_ALLOW_THREADS
+    err = TreeWalkIter_fill(self);
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        Error_set(err);
+        goto out;
+    }
+
+    if (self->n == 0)
+        goto out;
+
+    list = PyList_New(self->n);
+    if (list == NULL)
+        goto out;
+
+    for (i = 0; i < self->n; i++) {
+        tuple = Py_BuildValue("(NNi)",
+                              to_path(self->paths + self->path_starts[i]),
+                              git_oid_to_python(&self->oids[i]),
+                              self->modes[i]);
+        if (tuple == NULL) {
+            Py_CLEAR(list);
+            goto out;
+        }
+        PyList_SET_ITEM(list, i, tuple);
+    }
+
+out:
+    self->busy = 0;
+    return list;
+}
+
+
+PyDoc_STRVAR(TreeWalkIter__doc__, "Recursive tree iterator, see Tree.walk().");
+
+PyTypeObject TreeWalkIterType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.TreeWalkIter",                    /* tp_name           */
+    sizeof(TreeWalkIter),                      /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)TreeWalkIter_dealloc,          /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    TreeWalkIter__doc__,                       /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    PyObject_SelfIter,                         /* tp_iter           */
+    (iternextfunc)TreeWalkIter_iternext,       /* tp_iternext       */
+};
@@ -33,7 +33,7 @@
 #include <git2.h>
 #include "types.h"
 
-TreeEntry * wrap_tree_entry(const git_tree_entry *entry);
+TreeEntry * wrap_tree_entry(const git_tree_entry *entry, Tree *owner);
 PyObject* TreeEntry_get_filemode(TreeEntry *self);
 PyObject* TreeEntry_get_name(TreeEntry *self);
 PyObject* TreeEntry_get_oid(TreeEntry *self);
@@ -42,5 +42,8 @@ PyObject* TreeEntry_get_hex(TreeEntry *self);
 TreeEntry* Tree_getitem_by_index(Tree *self, PyObject *py_index);
 TreeEntry* Tree_getitem(Tree *self, PyObject *value);
 PyObject* Tree_diff_tree(Tree *self, PyObject *args);
+PyObject* Tree_changed_paths(Tree *self, PyObject *args);
+PyObject* Tree_entries_as_tuples(Tree *self);
+PyObject* Tree_walk(Tree *self, PyObject *args, PyObject *kwds);
 
 #endif
@@ -30,7 +30,9 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <pythread.h>
 #include <git2.h>
+#include "error.h"
 
 #if !(LIBGIT2_VER_MAJOR == 0 && LIBGIT2_VER_MINOR == 22)
 #error You need a compatible libgit2 version (v0.22.x)
@@ -41,6 +43,33 @@
  *
  **/
 
+/* Bounded LRU of object wrappers, and weak references to those evicted
+ * but still alive, keyed by oid (see objectcache.c) */
+typedef struct ObjectCacheEntry {
+    git_oid oid;
+    PyObject *obj;                  /* NULL once evicted from the LRU */
+    PyObject *ref;                  /* Weak reference to the wrapper */
+    struct ObjectCacheEntry *prev;  /* LRU list, most recently used first */
+    struct ObjectCacheEntry *next;
+    struct ObjectCacheEntry *chain; /* Hash bucket chain */
+} ObjectCacheEntry;
+
+typedef struct {
+    ObjectCacheEntry **buckets;
+    size_t nbuckets;
+    ObjectCacheEntry *head;
+    ObjectCacheEntry *tail;
+    size_t size;      /* Of the LRU */
+    size_t capacity;  /* 0 means the cache is disabled */
+    size_t nweak;     /* Entries evicted from the LRU */
+    size_t sweep_at;  /* For dead weak entries, past that many */
+    size_t hits;
+    size_t misses;
+} ObjectCache;
+
+/* A commit-graph file (see graph.c) */
+typedef struct CommitGraph CommitGraph;
+
 /* git_repository */
 typedef struct {
     PyObject_HEAD
@@ -48,6 +77,10 @@ typedef struct {
     PyObject *index;  /* It will be None for a bare repository */
     PyObject *config; /* It will be None for a bare repository */
     int owned;    /* _from_c() sometimes means we don't own the C pointer */
+    PyThread_type_lock lock; /* Serializes GIL-free access to shared state */
+    ObjectCache cache;
+    CommitGraph *graph;  /* NULL unless a commit-graph file was loaded */
+    int graph_checked;   /* Whether the default file has been looked for */
 } Repository;
 
 
@@ -57,6 +90,64 @@ typedef struct {
 } Oid;
 
 
+/* git_odb_object */
+typedef struct {
+    PyObject_HEAD
+    git_odb_object *obj;
+} OdbObject;
+
+/* A loose object inflated as it is read, see odb.c */
+typedef struct LooseStream LooseStream;
+
+/* git_odb_stream, a loose object, or an in-memory object read like a file */
+typedef struct {
+    PyObject_HEAD
+    git_odb *odb;
+    git_odb_stream *stream;  /* when the odb backend can stream the object */
+    LooseStream *loose;      /* or when it is a loose object */
+    PyObject *hash;          /* of the loose object, checked at its end */
+    git_oid oid;             /* the hash should match */
+    Py_buffer view;          /* otherwise, the whole object */
+    size_t offset;
+    Py_ssize_t chunk_size;
+    int closed;
+} OdbReader;
+
+/* git_packbuilder, fed from an in-memory odb backend */
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_repository *pack_repo;  /* private handle, writes go to mempack */
+    git_odb *odb;
+    git_odb_backend *mempack;
+    git_oid *oids;              /* objects written since the last commit */
+    size_t n;
+    size_t alloc;
+} PackWriter;
+
+/* git_odb_foreach, run on a worker thread and handed over in chunks */
+#define ODB_ITER_CHUNK 1024
+
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_odb *odb;
+    git_otype type;
+    PyThread_type_lock chunk_ready;  /* released by the worker */
+    PyThread_type_lock chunk_taken;  /* released by the iterator */
+    git_oid chunk[ODB_ITER_CHUNK];   /* filled by the worker */
+    size_t chunk_len;
+    git_oid oids[ODB_ITER_CHUNK];    /* copy of the last chunk taken */
+    size_t i;
+    size_t n;
+    int started;
+    int finished;
+    volatile int done;
+    volatile int cancelled;
+    SavedError error;
+} OdbIter;
+
+
 #define SIMPLE_TYPE(_name, _ptr_type, _ptr_name) \
         typedef struct {\
             PyObject_HEAD\
@@ -67,13 +158,21 @@ typedef struct {
 
 /* git object types
  *
- * The structs for some of the object subtypes are identical except for
- * the type of their object pointers. */
-SIMPLE_TYPE(Object, git_object, obj)
-SIMPLE_TYPE(Commit, git_commit, commit)
-SIMPLE_TYPE(Tree, git_tree, tree)
-SIMPLE_TYPE(Blob, git_blob, blob)
-SIMPLE_TYPE(Tag, git_tag, tag)
+ * The structs for the object subtypes are identical except for the type of
+ * their object pointers.  They support weak references, for the cache. */
+#define OBJECT_TYPE(_name, _ptr_type, _ptr_name) \
+        typedef struct {\
+            PyObject_HEAD\
+            Repository *repo;\
+            _ptr_type *_ptr_name;\
+            PyObject *weakreflist;\
+        } _name;
+
+OBJECT_TYPE(Object, git_object, obj)
+OBJECT_TYPE(Commit, git_commit, commit)
+OBJECT_TYPE(Tree, git_tree, tree)
+OBJECT_TYPE(Blob, git_blob, blob)
+OBJECT_TYPE(Tag, git_tag, tag)
 
 /* git_note */
 typedef struct {
@@ -94,9 +193,16 @@ typedef struct {
 typedef struct {
     PyObject_HEAD
     git_patch *patch;
-    PyObject* hunks;
 } Patch;
 
+/* Patch.hunks, or DiffHunk.lines: DiffHunk and DiffLine objects are only
+ * made as they are accessed */
+typedef struct {
+    PyObject_HEAD
+    Patch *patch;
+    size_t hunk;     /* For DiffHunk.lines */
+} PatchView;
+
 /* git_diff */
 SIMPLE_TYPE(Diff, git_diff, diff)
 
@@ -107,6 +213,21 @@ typedef struct {
     size_t n;
 } DiffIter;
 
+/* Diff.iter_patch_chunks() */
+typedef struct {
+    PyObject_HEAD
+    Diff *diff;
+    size_t i;            /* The next delta to print */
+    size_t n;
+    char *data;          /* Printed, whole lines only */
+    size_t size;
+    size_t alloc;
+    size_t pos;          /* Start of what has not been yielded yet */
+    size_t chunk_size;
+    int as_bytes;
+    int busy;            /* Set while a chunk is being cut */
+} DiffPatchIter;
+
 typedef struct {
     PyObject_HEAD
     PyObject *id;
@@ -128,7 +249,8 @@ typedef struct {
 
 typedef struct {
     PyObject_HEAD
-    PyObject* lines;
+    Patch *patch;
+    size_t idx;
     int old_start;
     int old_lines;
     int new_start;
@@ -151,9 +273,12 @@ SIMPLE_TYPE(DiffStats, git_diff_stats, stats);
 /* git_tree_walk , git_treebuilder*/
 SIMPLE_TYPE(TreeBuilder, git_treebuilder, bld)
 
+/* The entry is borrowed from the owner's tree if there is an owner, else
+ * it is a copy owned by the TreeEntry */
 typedef struct {
     PyObject_HEAD
     const git_tree_entry *entry;
+    Tree *owner;
 } TreeEntry;
 
 typedef struct {
@@ -162,6 +287,38 @@ typedef struct {
     int i;
 } TreeIter;
 
+/* A directory being walked by Tree.walk() */
+typedef struct {
+    git_tree *tree;
+    size_t i;                        /* The next entry */
+    size_t path_len;                 /* Of the directory, slash included */
+    const git_tree_entry *entry;     /* To yield once done (post-order) */
+} TreeWalkFrame;
+
+typedef struct {
+    PyObject_HEAD
+    Tree *owner;
+    int mode;                        /* GIT_TREEWALK_PRE or _POST */
+    size_t batch;
+    git_pathspec *pathspec;          /* NULL to yield everything */
+    char *prefixes;                  /* The literal prefix of each pattern */
+    size_t n_prefixes;
+    TreeWalkFrame *stack;            /* stack[0] borrows the owner's tree */
+    size_t depth;
+    size_t stack_alloc;
+    char *path;
+    size_t path_alloc;
+    /* The batch being filled */
+    char *paths;
+    size_t paths_size;
+    size_t paths_alloc;
+    size_t *path_starts;
+    git_oid *oids;
+    git_filemode_t *modes;
+    size_t n;
+    int busy;                        /* Set while a batch is being built */
+} TreeWalkIter;
+
 
 /* git_index */
 SIMPLE_TYPE(Index, git_index, index)
@@ -172,9 +329,43 @@ typedef struct {
 } IndexEntry;
 
 
-/* git_reference, git_reflog */
-SIMPLE_TYPE(Walker, git_revwalk, walk)
+/* Commit data in columns (see walker.h) */
+typedef struct CommitColumns CommitColumns;
+
+/* git_revwalk */
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_revwalk *walk;
+    int ids_only;  /* Iteration yields Oids instead of Commits */
+    char *paths;   /* filter_paths(), "a\0b\0\0c\0\0" for a/b and c */
+    size_t paths_size;
+} Walker;
+
+/* A range of a parallel walk: the commits reachable from start, but not
+ * from stop (when there is one), nor from the first n_hide roots */
+typedef struct {
+    git_oid start;
+    git_oid stop;
+    int has_stop;
+    size_t n_hide;
+} WalkRange;
 
+typedef struct {
+    PyObject_HEAD
+    Repository *repo;
+    git_oid *roots;
+    size_t n_roots;
+    WalkRange *ranges;
+    size_t n_ranges;
+    size_t next_range;       /* The first range not walked yet */
+    CommitColumns *results;  /* The ranges walked in the last round */
+    size_t n_results;
+    size_t next_result;
+    int threads;
+} ParallelWalker;
+
+/* git_reference, git_reflog */
 SIMPLE_TYPE(Reference, git_reference, reference)
 
 typedef Reference Branch;
@@ -55,6 +55,7 @@
   #define PyBytes_FromString PyString_FromString
   #define PyBytes_FromStringAndSize PyString_FromStringAndSize
   #define PyBytes_Size PyString_Size
+  #define _PyBytes_Resize _PyString_Resize
   #define to_path(x) to_bytes(x)
   #define to_encoding(x) to_bytes(x)
 #else
@@ -73,6 +74,22 @@
 #endif
 
 
+/* Release the GIL around a libgit2 call.  Object database reads and object
+ * lookups are thread-safe in libgit2, so Py_BEGIN_ALLOW_THREADS is enough
+ * for them.  State libgit2 does not protect (the index, the working
+ * directory, revision walkers) is guarded by the per-repository lock, which
+ * is only ever waited for with the GIL released so the two cannot deadlock.
+ * Every user of that state takes it, readers and writers alike; the cffi
+ * code does so through Repository._lock(), see pygit2.utils.RepositoryLock. */
+#define REPOSITORY_BEGIN_ALLOW_THREADS(py_repo)\
+    Py_BEGIN_ALLOW_THREADS\
+    PyThread_acquire_lock((py_repo)->lock, WAIT_LOCK);
+
+#define REPOSITORY_END_ALLOW_THREADS(py_repo)\
+    PyThread_release_lock((py_repo)->lock);\
+    Py_END_ALLOW_THREADS
+
+
 #define CHECK_REFERENCE(self)\
     if (self->reference == NULL) {\
         PyErr_SetString(GitError, "deleted reference");\
@@ -27,19 +27,26 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <string.h>
 #include "error.h"
 #include "utils.h"
 #include "oid.h"
 #include "tree.h"
+#include "object.h"
 #include "walker.h"
+#include "graph.h"
+#include "parallel.h"
+#include "repository.h"
+
+extern PyTypeObject ParallelWalkerType;
 
-extern PyTypeObject CommitType;
 
 void
 Walker_dealloc(Walker *self)
 {
     Py_CLEAR(self->repo);
     git_revwalk_free(self->walk);
+    free(self->paths);
     PyObject_Del(self);
 }
 
@@ -59,7 +66,9 @@ Walker_hide(Walker *self, PyObject *py_hex)
     if (err < 0)
         return NULL;
 
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
     err = git_revwalk_hide(self->walk, &oid);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
     if (err < 0)
         return Error_set(err);
 
@@ -82,7 +91,9 @@ Walker_push(Walker *self, PyObject *py_hex)
     if (err < 0)
         return NULL;
 
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
     err = git_revwalk_push(self->walk, &oid);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
     if (err < 0)
         return Error_set(err);
 
@@ -104,7 +115,9 @@ Walker_sort(Walker *self, PyObject *py_sort_mode)
     if (sort_mode == -1 && PyErr_Occurred())
         return NULL;
 
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
     git_revwalk_sorting(self->walk, sort_mode);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
 
     Py_RETURN_NONE;
 }
@@ -118,7 +131,9 @@ PyDoc_STRVAR(Walker_reset__doc__,
 PyObject *
 Walker_reset(Walker *self)
 {
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
     git_revwalk_reset(self->walk);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
     Py_RETURN_NONE;
 }
 
@@ -130,10 +145,233 @@ PyDoc_STRVAR(Walker_simplify_first_parent__doc__,
 PyObject *
 Walker_simplify_first_parent(Walker *self)
 {
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
     git_revwalk_simplify_first_parent(self->walk);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
     Py_RETURN_NONE;
 }
 
+PyDoc_STRVAR(Walker_filter_paths__doc__,
+  "filter_paths(paths)\n"
+  "\n"
+  "Only yield the commits that changed any of the given paths, like\n"
+  "'git log -- paths'.  A path naming a directory covers everything\n"
+  "within it.  A merge is only yielded if it differs from every parent at\n"
+  "the paths, but unlike git the walk does not prune the parents a merge\n"
+  "is the same as.  An empty list removes the filter.\n"
+  "\n"
+  "The trees are compared one path component at a time, stopping at the\n"
+  "first subtree with the same id, so no diff is ever computed.");
+
+PyObject *
+Walker_filter_paths(Walker *self, PyObject *py_paths)
+{
+    PyObject *seq, *tpath;
+    const char *path, *end;
+    char *paths = NULL, *ptr;
+    size_t size = 0, len;
+    Py_ssize_t i, n;
+
+    seq = PySequence_Fast(py_paths, "expected a sequence of paths");
+    if (seq == NULL)
+        return NULL;
+
+    n = PySequence_Fast_GET_SIZE(seq);
+    for (i = 0; i < n; i++) {
+        path = py_str_borrow_c_str(&tpath, PySequence_Fast_GET_ITEM(seq, i),
+                                   Py_FileSystemDefaultEncoding);
+        if (path == NULL)
+            goto error;
+
+        /* Splitting never makes a path longer, but for the final empty
+         * component */
+        ptr = realloc(paths, size + strlen(path) + 2);
+        if (ptr == NULL) {
+            Py_DECREF(tpath);
+            PyErr_NoMemory();
+            goto error;
+        }
+        paths = ptr;
+
+        len = 0;
+        for (end = path; *path != '\0'; path = end) {
+            for (end = path; *end != '\0' && *end != '/'; end++);
+            if (end > path) {
+                memcpy(paths + size, path, end - path);
+                size += end - path;
+                paths[size++] = '\0';
+                len++;
+            }
+            if (*end == '/')
+                end++;
+        }
+        Py_DECREF(tpath);
+
+        if (len == 0) {
+            PyErr_SetString(PyExc_ValueError, "empty path");
+            goto error;
+        }
+        paths[size++] = '\0';
+    }
+    Py_DECREF(seq);
+
+    /* A walk running on another thread reads the filter with the lock */
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    free(self->paths);
+    self->paths = paths;
+    self->paths_size = size;
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    Py_RETURN_NONE;
+
+error:
+    free(paths);
+    Py_DECREF(seq);
+    return NULL;
+}
+
+/*
+ * Tells whether a path differs between two trees, either of which may be
+ * missing.  The path is split as in Walker.paths, and is advanced past its
+ * final empty component.
+ */
+static int
+tree_path_differs(int *differs, git_repository *repo, const git_oid *tree_a,
+                  const git_oid *tree_b, const char **path)
+{
+    const git_tree_entry *entry;
+    git_tree *tree;
+    git_oid oids[2];
+    git_filemode_t modes[2] = {GIT_FILEMODE_TREE, GIT_FILEMODE_TREE};
+    int has[2], i, err;
+    const char *name = *path;
+
+    has[0] = tree_a != NULL;
+    has[1] = tree_b != NULL;
+    if (has[0])
+        git_oid_cpy(&oids[0], tree_a);
+    if (has[1])
+        git_oid_cpy(&oids[1], tree_b);
+
+    for (;; name += strlen(name) + 1) {
+        if (*name == '\0') {
+            *differs = has[0] != has[1] ||
+                       (has[0] && (!git_oid_equal(&oids[0], &oids[1]) ||
+                                   modes[0] != modes[1]));
+            break;
+        }
+
+        /* The same subtree, or nothing on either side */
+        if ((has[0] && has[1] && git_oid_equal(&oids[0], &oids[1]) &&
+             modes[0] == GIT_FILEMODE_TREE && modes[1] == GIT_FILEMODE_TREE) ||
+            (!has[0] && !has[1])) {
+            *differs = 0;
+            break;
+        }
+
+        for (i = 0; i < 2; i++) {
+            if (!has[i])
+                continue;
+
+            has[i] = 0;
+            if (modes[i] != GIT_FILEMODE_TREE)
+                continue;
+
+            err = git_tree_lookup(&tree, repo, &oids[i]);
+            if (err < 0)
+                return err;
+
+            entry = git_tree_entry_byname(tree, name);
+            if (entry != NULL) {
+                has[i] = 1;
+                git_oid_cpy(&oids[i], git_tree_entry_id(entry));
+                modes[i] = git_tree_entry_filemode(entry);
+            }
+            git_tree_free(tree);
+        }
+    }
+
+    /* Skip to the next path */
+    while (*name != '\0')
+        name += strlen(name) + 1;
+    *path = name + 1;
+    return 0;
+}
+
+/* Tells whether any of the paths differs between two trees */
+static int
+tree_paths_differ(int *differs, Walker *self, const git_oid *tree_a,
+                  const git_oid *tree_b)
+{
+    const char *path = self->paths;
+    const char *end = self->paths + self->paths_size;
+    int err;
+
+    *differs = 0;
+    while (path < end && !*differs) {
+        err = tree_path_differs(differs, self->repo->repo, tree_a, tree_b,
+                                &path);
+        if (err < 0)
+            return err;
+    }
+
+    return 0;
+}
+
+/* A commit touches the paths unless it is the same as one of its parents
+ * there */
+static int
+commit_touches_paths(int *touches, Walker *self, const git_oid *oid)
+{
+    git_commit *commit, *parent;
+    unsigned int i, n;
+    int err = 0;
+
+    err = git_commit_lookup(&commit, self->repo->repo, oid);
+    if (err < 0)
+        return err;
+
+    n = git_commit_parentcount(commit);
+    if (n == 0) {
+        err = tree_paths_differ(touches, self, git_commit_tree_id(commit),
+                                NULL);
+        goto exit;
+    }
+
+    *touches = 1;
+    for (i = 0; i < n && *touches; i++) {
+        err = git_commit_parent(&parent, commit, i);
+        if (err < 0)
+            goto exit;
+
+        err = tree_paths_differ(touches, self, git_commit_tree_id(commit),
+                                git_commit_tree_id(parent));
+        git_commit_free(parent);
+        if (err < 0)
+            goto exit;
+    }
+
+exit:
+    git_commit_free(commit);
+    return err;
+}
+
+/* git_revwalk_next() with the path filter.  Needs the repository lock. */
+static int
+walker_next(git_oid *oid, Walker *self)
+{
+    int err, touches;
+
+    for (;;) {
+        err = git_revwalk_next(oid, self->walk);
+        if (err < 0 || self->paths == NULL)
+            return err;
+
+        err = commit_touches_paths(&touches, self, oid);
+        if (err < 0 || touches)
+            return err;
+    }
+}
+
 PyObject *
 Walker_iter(Walker *self)
 {
@@ -145,33 +383,370 @@ PyObject *
 Walker_iternext(Walker *self)
 {
     int err;
-    git_commit *commit;
-    Commit *py_commit;
     git_oid oid;
 
-    err = git_revwalk_next(&oid, self->walk);
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    err = walker_next(&oid, self);
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
     if (err < 0)
         return Error_set(err);
 
-    err = git_commit_lookup(&commit, self->repo->repo, &oid);
-    if (err < 0)
+    if (self->ids_only)
+        return git_oid_to_python(&oid);
+
+    return lookup_object(self->repo, &oid, GIT_OBJ_COMMIT);
+}
+
+PyDoc_STRVAR(Walker_next_ids__doc__,
+  "next_ids(n) -> bytes\n"
+  "\n"
+  "Walk up to n more commits and return their raw 20-byte ids one after\n"
+  "the other.  The result is shorter than n ids only at the end of the\n"
+  "walk, and empty once the walk is over.");
+
+PyObject *
+Walker_next_ids(Walker *self, PyObject *py_n)
+{
+    Py_ssize_t n, i = 0;
+    PyObject *py_ids;
+    unsigned char *ids;
+    git_oid oid;
+    int err = 0;
+
+    n = PyNumber_AsSsize_t(py_n, PyExc_OverflowError);
+    if (n == -1 && PyErr_Occurred())
+        return NULL;
+
+    if (n < 0 || n > PY_SSIZE_T_MAX / GIT_OID_RAWSZ) {
+        PyErr_SetString(PyExc_ValueError, "invalid number of ids");
+        return NULL;
+    }
+
+    py_ids = PyBytes_FromStringAndSize(NULL, n * GIT_OID_RAWSZ);
+    if (py_ids == NULL)
+        return NULL;
+
+    ids = (unsigned char *)PyBytes_AS_STRING(py_ids);
+
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    for (; i < n; i++) {
+        err = walker_next(&oid, self);
+        if (err < 0)
+            break;
+        memcpy(ids + i * GIT_OID_RAWSZ, oid.id, GIT_OID_RAWSZ);
+    }
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    if (err < 0 && err != GIT_ITEROVER) {
+        Py_DECREF(py_ids);
         return Error_set(err);
+    }
+
+    if (i < n && _PyBytes_Resize(&py_ids, i * GIT_OID_RAWSZ) < 0)
+        return NULL;
 
-    py_commit = PyObject_New(Commit, &CommitType);
-    if (py_commit) {
-        py_commit->commit = commit;
-        Py_INCREF(self->repo);
-        py_commit->repo = self->repo;
+    return py_ids;
+}
+
+
+/* Python 2 arrays have no 64-bit typecodes, long is the widest there */
+#if PY_MAJOR_VERSION == 2
+  typedef long column_int64_t;
+  typedef unsigned long column_uint64_t;
+  #define INT64_TYPECODE "l"
+  #define UINT64_TYPECODE "L"
+#else
+  typedef PY_LONG_LONG column_int64_t;
+  typedef unsigned PY_LONG_LONG column_uint64_t;
+  #define INT64_TYPECODE "q"
+  #define UINT64_TYPECODE "Q"
+#endif
+
+#define N_COLUMNS (sizeof(CommitColumns) / sizeof(Column))
+
+static int
+column_append(Column *col, const void *data, size_t len)
+{
+    size_t alloc;
+    char *ptr;
+
+    if (col->size + len > col->alloc) {
+        alloc = col->alloc ? col->alloc : 4096;
+        while (alloc < col->size + len)
+            alloc *= 2;
+
+        ptr = realloc(col->data, alloc);
+        if (ptr == NULL) {
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+        col->data = ptr;
+        col->alloc = alloc;
+    }
+
+    memcpy(col->data + col->size, data, len);
+    col->size += len;
+    return 0;
+}
+
+/* Strings are stored Arrow-style: the concatenated bytes, and the n + 1
+ * offsets delimiting them. */
+static int
+column_append_str(Column *data, Column *offsets, const char *str)
+{
+    column_uint64_t end;
+    int err;
+
+    err = column_append(data, str, strlen(str));
+    if (err < 0)
+        return err;
+
+    end = data->size;
+    return column_append(offsets, &end, sizeof(end));
+}
+
+int
+commit_columns_init(CommitColumns *cols)
+{
+    column_uint64_t zero = 0;
+    int err;
+
+    memset(cols, 0, sizeof(CommitColumns));
+    if ((err = column_append(&cols->author_name_offsets, &zero,
+                             sizeof(zero))) < 0 ||
+        (err = column_append(&cols->author_email_offsets, &zero,
+                             sizeof(zero))) < 0 ||
+        (err = column_append(&cols->committer_name_offsets, &zero,
+                             sizeof(zero))) < 0 ||
+        (err = column_append(&cols->committer_email_offsets, &zero,
+                             sizeof(zero))) < 0)
+        return err;
+
+    return 0;
+}
+
+void
+commit_columns_free(CommitColumns *cols)
+{
+    Column *col;
+    size_t i;
+
+    for (i = 0, col = (Column *)cols; i < N_COLUMNS; i++, col++) {
+        free(col->data);
+        col->data = NULL;
     }
-    return (PyObject*)py_commit;
+}
+
+int
+commit_columns_append(CommitColumns *cols, const git_commit *commit)
+{
+    const git_signature *author, *committer;
+    column_int64_t time;
+    int offset;
+    unsigned int parents;
+    int err;
+
+    author = git_commit_author(commit);
+    committer = git_commit_committer(commit);
+    time = git_commit_time(commit);
+    offset = git_commit_time_offset(commit);
+    parents = git_commit_parentcount(commit);
+
+    if ((err = column_append(&cols->id, git_commit_id(commit)->id,
+                             GIT_OID_RAWSZ)) < 0 ||
+        (err = column_append(&cols->tree_id, git_commit_tree_id(commit)->id,
+                             GIT_OID_RAWSZ)) < 0 ||
+        (err = column_append(&cols->commit_time, &time,
+                             sizeof(time))) < 0 ||
+        (err = column_append(&cols->commit_time_offset, &offset,
+                             sizeof(offset))) < 0 ||
+        (err = column_append(&cols->parent_count, &parents,
+                             sizeof(parents))) < 0 ||
+        (err = column_append_str(&cols->author_name,
+                                 &cols->author_name_offsets,
+                                 author->name)) < 0 ||
+        (err = column_append_str(&cols->author_email,
+                                 &cols->author_email_offsets,
+                                 author->email)) < 0 ||
+        (err = column_append_str(&cols->committer_name,
+                                 &cols->committer_name_offsets,
+                                 committer->name)) < 0 ||
+        (err = column_append_str(&cols->committer_email,
+                                 &cols->committer_email_offsets,
+                                 committer->email)) < 0)
+        return err;
+
+    cols->count++;
+    return 0;
+}
+
+static PyObject *
+column_to_bytes(Column *col)
+{
+    return PyBytes_FromStringAndSize(col->data, col->size);
+}
+
+static PyObject *
+column_to_array(PyObject *array_type, const char *typecode, Column *col)
+{
+    PyObject *py_bytes, *py_array;
+
+    py_bytes = column_to_bytes(col);
+    if (py_bytes == NULL)
+        return NULL;
+
+    py_array = PyObject_CallFunction(array_type, "sO", typecode, py_bytes);
+    Py_DECREF(py_bytes);
+    return py_array;
+}
+
+/* Builds the dictionary documented in Walker.to_arrays() */
+PyObject *
+commit_columns_to_dict(CommitColumns *cols)
+{
+    PyObject *array_module, *array_type = NULL, *dict = NULL, *py_col;
+    size_t i;
+    int err;
+    /* A NULL typecode exports the column as bytes */
+    struct {
+        const char *key;
+        const char *typecode;
+        Column *col;
+    } exports[] = {
+        {"id", NULL, &cols->id},
+        {"tree_id", NULL, &cols->tree_id},
+        {"commit_time", INT64_TYPECODE, &cols->commit_time},
+        {"commit_time_offset", "i", &cols->commit_time_offset},
+        {"parent_count", "I", &cols->parent_count},
+        {"author_name", NULL, &cols->author_name},
+        {"author_name_offsets", UINT64_TYPECODE, &cols->author_name_offsets},
+        {"author_email", NULL, &cols->author_email},
+        {"author_email_offsets", UINT64_TYPECODE,
+         &cols->author_email_offsets},
+        {"committer_name", NULL, &cols->committer_name},
+        {"committer_name_offsets", UINT64_TYPECODE,
+         &cols->committer_name_offsets},
+        {"committer_email", NULL, &cols->committer_email},
+        {"committer_email_offsets", UINT64_TYPECODE,
+         &cols->committer_email_offsets},
+    };
+
+    array_module = PyImport_ImportModule("array");
+    if (array_module == NULL)
+        return NULL;
+
+    array_type = PyObject_GetAttrString(array_module, "array");
+    if (array_type == NULL)
+        goto exit;
+
+    dict = PyDict_New();
+    if (dict == NULL)
+        goto exit;
+
+    for (i = 0; i < sizeof(exports) / sizeof(exports[0]); i++) {
+        if (exports[i].typecode == NULL)
+            py_col = column_to_bytes(exports[i].col);
+        else
+            py_col = column_to_array(array_type, exports[i].typecode,
+                                     exports[i].col);
+        if (py_col == NULL) {
+            Py_CLEAR(dict);
+            goto exit;
+        }
+
+        err = PyDict_SetItemString(dict, exports[i].key, py_col);
+        Py_DECREF(py_col);
+        if (err < 0) {
+            Py_CLEAR(dict);
+            goto exit;
+        }
+    }
+
+exit:
+    Py_XDECREF(array_type);
+    Py_DECREF(array_module);
+    return dict;
+}
+
+PyDoc_STRVAR(Walker_to_arrays__doc__,
+  "to_arrays([limit]) -> dict\n"
+  "\n"
+  "Walk the remaining commits (at most limit of them) and return them as\n"
+  "columns, without creating a Python object per commit.  The dictionary\n"
+  "maps:\n"
+  "\n"
+  "- 'id' and 'tree_id' to bytes holding the raw 20-byte ids one after\n"
+  "  the other;\n"
+  "- 'commit_time', 'commit_time_offset' and 'parent_count' to\n"
+  "  array.array objects;\n"
+  "- 'author_name', 'author_email', 'committer_name' and\n"
+  "  'committer_email' to bytes holding the concatenated strings, in the\n"
+  "  commit encoding, and the matching '<name>_offsets' to arrays of n + 1\n"
+  "  offsets, so string i is data[offsets[i]:offsets[i + 1]].\n"
+  "\n"
+  "Like iteration, this consumes the walker.");
+
+PyObject *
+Walker_to_arrays(Walker *self, PyObject *args)
+{
+    CommitColumns cols;
+    Py_ssize_t limit = -1, n = 0;
+    git_commit *commit;
+    git_oid oid;
+    PyObject *dict = NULL;
+    int err;
+
+    if (!PyArg_ParseTuple(args, "|n", &limit))
+        return NULL;
+
+    err = commit_columns_init(&cols);
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    REPOSITORY_BEGIN_ALLOW_THREADS(self->repo)
+    while (limit < 0 || n < limit) {
+        err = walker_next(&oid, self);
+        if (err == GIT_ITEROVER) {
+            err = 0;
+            break;
+        }
+        if (err < 0)
+            break;
+
+        err = git_commit_lookup(&commit, self->repo->repo, &oid);
+        if (err < 0)
+            break;
+
+        err = commit_columns_append(&cols, commit);
+        git_commit_free(commit);
+        if (err < 0)
+            break;
+
+        n++;
+    }
+    REPOSITORY_END_ALLOW_THREADS(self->repo)
+    if (err < 0) {
+        Error_set(err);
+        goto exit;
+    }
+
+    dict = commit_columns_to_dict(&cols);
+
+exit:
+    commit_columns_free(&cols);
+    return dict;
 }
 
 PyMethodDef Walker_methods[] = {
+    METHOD(Walker, filter_paths, METH_O),
     METHOD(Walker, hide, METH_O),
+    METHOD(Walker, next_ids, METH_O),
     METHOD(Walker, push, METH_O),
     METHOD(Walker, reset, METH_NOARGS),
     METHOD(Walker, simplify_first_parent, METH_NOARGS),
     METHOD(Walker, sort, METH_O),
+    METHOD(Walker, to_arrays, METH_VARARGS),
     {NULL}
 };
 
@@ -218,3 +793,438 @@ PyTypeObject WalkerType = {
     0,                                         /* tp_alloc          */
     0,                                         /* tp_new            */
 };
+
+
+/*
+ * Parallel walks.  The commits reachable from the roots are cut into
+ * disjoint ranges, which are walked by independent revision walkers on
+ * several threads.
+ *
+ * The ranges of a root are cut along its first-parent chain, every chunk
+ * commits: each range starts at a cut and hides the next one.  The chain
+ * stops at the first commit already met on the chain of an earlier root,
+ * and every range of a root hides the earlier roots, so that together the
+ * ranges hold every commit exactly once.
+ */
+
+/* A set of oids, with open addressing */
+typedef struct {
+    git_oid *oids;
+    char *used;
+    size_t size;             /* A power of two */
+    size_t count;
+} OidSet;
+
+static size_t
+oid_set_slot(const OidSet *set, const git_oid *oid)
+{
+    size_t i;
+
+    memcpy(&i, oid->id, sizeof(i));
+    for (i &= set->size - 1; set->used[i]; i = (i + 1) & (set->size - 1)) {
+        if (git_oid_equal(&set->oids[i], oid))
+            break;
+    }
+
+    return i;
+}
+
+/* Returns 1 if the oid was added, 0 if it was there already */
+static int
+oid_set_add(OidSet *set, const git_oid *oid)
+{
+    OidSet bigger;
+    size_t i;
+
+    if (set->count * 2 >= set->size) {
+        bigger.size = set->size ? set->size * 2 : 1024;
+        bigger.count = set->count;
+        bigger.oids = malloc(bigger.size * sizeof(git_oid));
+        bigger.used = calloc(bigger.size, 1);
+        if (bigger.oids == NULL || bigger.used == NULL) {
+            free(bigger.oids);
+            free(bigger.used);
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+
+        for (i = 0; i < set->size; i++) {
+            if (set->used[i]) {
+                size_t slot = oid_set_slot(&bigger, &set->oids[i]);
+                git_oid_cpy(&bigger.oids[slot], &set->oids[i]);
+                bigger.used[slot] = 1;
+            }
+        }
+
+        free(set->oids);
+        free(set->used);
+        *set = bigger;
+    }
+
+    i = oid_set_slot(set, oid);
+    if (set->used[i])
+        return 0;
+
+    git_oid_cpy(&set->oids[i], oid);
+    set->used[i] = 1;
+    set->count++;
+    return 1;
+}
+
+static int
+first_parent(git_oid *out, int *found, git_repository *repo,
+             const CommitGraph *graph, const git_oid *oid)
+{
+    git_commit *commit;
+    uint32_t pos;
+    int err;
+
+    if (graph != NULL && commit_graph_find(graph, oid, &pos)) {
+        *found = graph->parent_start[pos] < graph->parent_start[pos + 1];
+        if (*found) {
+            pos = graph->parents[graph->parent_start[pos]];
+            git_oid_cpy(out, COMMIT_GRAPH_OID(graph, pos));
+        }
+        return 0;
+    }
+
+    err = git_commit_lookup(&commit, repo, oid);
+    if (err < 0)
+        return err;
+
+    *found = git_commit_parentcount(commit) > 0;
+    if (*found)
+        git_oid_cpy(out, git_commit_parent_id(commit, 0));
+    git_commit_free(commit);
+    return 0;
+}
+
+static int
+walk_ranges_append(WalkRange **ranges, size_t *n, size_t *alloc,
+                   const git_oid *start, const git_oid *stop, size_t n_hide)
+{
+    WalkRange *range;
+
+    if (*n == *alloc) {
+        *alloc = *alloc ? *alloc * 2 : 64;
+        range = realloc(*ranges, *alloc * sizeof(WalkRange));
+        if (range == NULL) {
+            giterr_set_oom();
+            return GIT_ERROR;
+        }
+        *ranges = range;
+    }
+
+    range = &(*ranges)[(*n)++];
+    git_oid_cpy(&range->start, start);
+    range->has_stop = (stop != NULL);
+    if (stop != NULL)
+        git_oid_cpy(&range->stop, stop);
+    range->n_hide = n_hide;
+    return 0;
+}
+
+/* Cuts the walk into ranges, see above.  Does not need the GIL. */
+static int
+walk_ranges_split(WalkRange **out, size_t *n_out, git_repository *repo,
+                  const CommitGraph *graph, const git_oid *roots,
+                  size_t n_roots, size_t chunk)
+{
+    OidSet seen = {NULL, NULL, 0, 0};
+    WalkRange *ranges = NULL;
+    size_t n = 0, alloc = 0, i, count;
+    git_oid start, oid, parent;
+    int err = 0, found;
+
+    for (i = 0; i < n_roots; i++) {
+        git_oid_cpy(&start, &roots[i]);
+        git_oid_cpy(&oid, &roots[i]);
+        count = 0;
+
+        for (;;) {
+            err = oid_set_add(&seen, &oid);
+            if (err <= 0)
+                break;
+
+            err = first_parent(&parent, &found, repo, graph, &oid);
+            if (err < 0 || !found)
+                break;
+
+            if (++count == chunk) {
+                err = walk_ranges_append(&ranges, &n, &alloc, &start,
+                                         &parent, i);
+                if (err < 0)
+                    break;
+                git_oid_cpy(&start, &parent);
+                count = 0;
+            }
+            git_oid_cpy(&oid, &parent);
+        }
+        if (err < 0)
+            goto error;
+
+        err = walk_ranges_append(&ranges, &n, &alloc, &start, NULL, i);
+        if (err < 0)
+            goto error;
+    }
+
+    free(seen.oids);
+    free(seen.used);
+    *out = ranges;
+    *n_out = n;
+    return 0;
+
+error:
+    free(seen.oids);
+    free(seen.used);
+    free(ranges);
+    return err;
+}
+
+
+typedef struct {
+    git_repository *repo;
+    const git_oid *roots;
+    const WalkRange *ranges;
+    CommitColumns *results;
+} WalkRound;
+
+static int
+walk_range(size_t i, void *payload)
+{
+    WalkRound *round = (WalkRound *)payload;
+    const WalkRange *range = &round->ranges[i];
+    CommitColumns *cols = &round->results[i];
+    git_revwalk *walk;
+    git_commit *commit;
+    git_oid oid;
+    size_t j;
+    int err;
+
+    err = commit_columns_init(cols);
+    if (err < 0)
+        return err;
+
+    err = git_revwalk_new(&walk, round->repo);
+    if (err < 0)
+        return err;
+
+    err = git_revwalk_push(walk, &range->start);
+    if (err < 0)
+        goto exit;
+
+    if (range->has_stop) {
+        err = git_revwalk_hide(walk, &range->stop);
+        if (err < 0)
+            goto exit;
+    }
+
+    for (j = 0; j < range->n_hide; j++) {
+        err = git_revwalk_hide(walk, &round->roots[j]);
+        if (err < 0)
+            goto exit;
+    }
+
+    while ((err = git_revwalk_next(&oid, walk)) == 0) {
+        err = git_commit_lookup(&commit, round->repo, &oid);
+        if (err < 0)
+            goto exit;
+
+        err = commit_columns_append(cols, commit);
+        git_commit_free(commit);
+        if (err < 0)
+            goto exit;
+    }
+    if (err == GIT_ITEROVER)
+        err = 0;
+
+exit:
+    git_revwalk_free(walk);
+    return err;
+}
+
+
+static void
+ParallelWalker_free_results(ParallelWalker *self)
+{
+    size_t i;
+
+    for (i = 0; i < self->n_results; i++)
+        commit_columns_free(&self->results[i]);
+    free(self->results);
+    self->results = NULL;
+    self->n_results = 0;
+    self->next_result = 0;
+}
+
+void
+ParallelWalker_dealloc(ParallelWalker *self)
+{
+    ParallelWalker_free_results(self);
+    free(self->roots);
+    free(self->ranges);
+    Py_CLEAR(self->repo);
+    PyObject_Del(self);
+}
+
+/* Walks the next ranges, as many as keeps every thread busy */
+static int
+ParallelWalker_round(ParallelWalker *self)
+{
+    WalkRound round;
+    SavedError error = {0, 0, NULL};
+    size_t n;
+    int err;
+
+    ParallelWalker_free_results(self);
+
+    n = self->n_ranges - self->next_range;
+    if (n > (size_t)self->threads * 4)
+        n = (size_t)self->threads * 4;
+
+    self->results = calloc(n, sizeof(CommitColumns));
+    if (self->results == NULL) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    self->n_results = n;
+
+    round.repo = self->repo->repo;
+    round.roots = self->roots;
+    round.ranges = self->ranges + self->next_range;
+    round.results = self->results;
+    self->next_range += n;
+
+    Py_BEGIN_ALLOW_THREADS
+    err = parallel_for(n, self->threads, walk_range, &round, &error);
+    Py_END_ALLOW_THREADS
+    if (err < 0) {
+        ParallelWalker_free_results(self);
+        self->next_range = self->n_ranges;
+        Error_set_saved(&error);
+        return -1;
+    }
+
+    return 0;
+}
+
+PyObject *
+ParallelWalker_iter(ParallelWalker *self)
+{
+    Py_INCREF(self);
+    return (PyObject*)self;
+}
+
+PyObject *
+ParallelWalker_iternext(ParallelWalker *self)
+{
+    CommitColumns *cols;
+    PyObject *dict;
+
+    for (;;) {
+        while (self->next_result < self->n_results) {
+            cols = &self->results[self->next_result++];
+            if (cols->count == 0)
+                continue;
+
+            dict = commit_columns_to_dict(cols);
+            commit_columns_free(cols);
+            return dict;
+        }
+
+        if (self->next_range == self->n_ranges)
+            return NULL;
+
+        if (ParallelWalker_round(self) < 0)
+            return NULL;
+    }
+}
+
+PyObject *
+wrap_parallel_walker(Repository *repo, git_oid *roots, size_t n_roots,
+                     int threads, size_t chunk)
+{
+    ParallelWalker *py_walker;
+    CommitGraph *graph;
+    WalkRange *ranges;
+    size_t n_ranges;
+    int err;
+
+    graph = Repository_get_commit_graph(repo);
+
+    Py_BEGIN_ALLOW_THREADS
+    err = walk_ranges_split(&ranges, &n_ranges, repo->repo, graph, roots,
+                            n_roots, chunk);
+    Py_END_ALLOW_THREADS
+    commit_graph_decref(graph);
+    if (err < 0) {
+        free(roots);
+        return Error_set(err);
+    }
+
+    py_walker = PyObject_New(ParallelWalker, &ParallelWalkerType);
+    if (py_walker == NULL) {
+        free(roots);
+        free(ranges);
+        return NULL;
+    }
+
+    Py_INCREF(repo);
+    py_walker->repo = repo;
+    py_walker->roots = roots;
+    py_walker->n_roots = n_roots;
+    py_walker->ranges = ranges;
+    py_walker->n_ranges = n_ranges;
+    py_walker->next_range = 0;
+    py_walker->results = NULL;
+    py_walker->n_results = 0;
+    py_walker->next_result = 0;
+    py_walker->threads = threads > 0 ? threads : parallel_cpu_count();
+    return (PyObject*)py_walker;
+}
+
+
+PyDoc_STRVAR(ParallelWalker__doc__,
+  "Iterator over the commits reachable from several roots, walked on\n"
+  "several threads.  See Repository.walk_parallel().");
+
+PyTypeObject ParallelWalkerType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    "_pygit2.ParallelWalker",                  /* tp_name           */
+    sizeof(ParallelWalker),                    /* tp_basicsize      */
+    0,                                         /* tp_itemsize       */
+    (destructor)ParallelWalker_dealloc,        /* tp_dealloc        */
+    0,                                         /* tp_print          */
+    0,                                         /* tp_getattr        */
+    0,                                         /* tp_setattr        */
+    0,                                         /* tp_compare        */
+    0,                                         /* tp_repr           */
+    0,                                         /* tp_as_number      */
+    0,                                         /* tp_as_sequence    */
+    0,                                         /* tp_as_mapping     */
+    0,                                         /* tp_hash           */
+    0,                                         /* tp_call           */
+    0,                                         /* tp_str            */
+    0,                                         /* tp_getattro       */
+    0,                                         /* tp_setattro       */
+    0,                                         /* tp_as_buffer      */
+    Py_TPFLAGS_DEFAULT,                        /* tp_flags          */
+    ParallelWalker__doc__,                     /* tp_doc            */
+    0,                                         /* tp_traverse       */
+    0,                                         /* tp_clear          */
+    0,                                         /* tp_richcompare    */
+    0,                                         /* tp_weaklistoffset */
+    (getiterfunc)ParallelWalker_iter,          /* tp_iter           */
+    (iternextfunc)ParallelWalker_iternext,     /* tp_iternext       */
+    0,                                         /* tp_methods        */
+    0,                                         /* tp_members        */
+    0,                                         /* tp_getset         */
+    0,                                         /* tp_base           */
+    0,                                         /* tp_dict           */
+    0,                                         /* tp_descr_get      */
+    0,                                         /* tp_descr_set      */
+    0,                                         /* tp_dictoffset     */
+    0,                                         /* tp_init           */
+    0,                                         /* tp_alloc          */
+    0,                                         /* tp_new            */
+};
@@ -33,12 +33,49 @@
 #include <git2.h>
 #include "types.h"
 
+/* A growable buffer holding one column of Walker.to_arrays() */
+typedef struct {
+    char *data;
+    size_t size;
+    size_t alloc;
+} Column;
+
+/* Per-commit data in columns, see Walker.to_arrays() */
+struct CommitColumns {
+    Column id;
+    Column tree_id;
+    Column commit_time;
+    Column commit_time_offset;
+    Column parent_count;
+    Column author_name, author_name_offsets;
+    Column author_email, author_email_offsets;
+    Column committer_name, committer_name_offsets;
+    Column committer_email, committer_email_offsets;
+    size_t count;
+};
+
+/* These do not need the GIL */
+int commit_columns_init(CommitColumns *cols);
+int commit_columns_append(CommitColumns *cols, const git_commit *commit);
+void commit_columns_free(CommitColumns *cols);
+
+PyObject* commit_columns_to_dict(CommitColumns *cols);
+
 void Walker_dealloc(Walker *self);
+PyObject* Walker_filter_paths(Walker *self, PyObject *py_paths);
 PyObject* Walker_hide(Walker *self, PyObject *py_hex);
 PyObject* Walker_push(Walker *self, PyObject *py_hex);
 PyObject* Walker_sort(Walker *self, PyObject *py_sort_mode);
 PyObject* Walker_reset(Walker *self);
 PyObject* Walker_iter(Walker *self);
 PyObject* Walker_iternext(Walker *self);
+PyObject* Walker_next_ids(Walker *self, PyObject *py_n);
+PyObject* Walker_to_arrays(Walker *self, PyObject *args);
+
+PyObject* wrap_parallel_walker(Repository *repo, git_oid *roots,
+                               size_t n_roots, int threads, size_t chunk);
+void ParallelWalker_dealloc(ParallelWalker *self);
+PyObject* ParallelWalker_iter(ParallelWalker *self);
+PyObject* ParallelWalker_iternext(ParallelWalker *self);
 
 #endif
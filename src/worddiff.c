@@ -0,0 +1,272 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Intra-line diffs.  Lines are split into tokens: runs of word characters,
+ * runs of whitespace, and single punctuation bytes.  Bytes from 0x80 up
+ * count as word characters, so UTF-8 sequences are never split.  The token
+ * sequences are diffed with Myers' O(ND) algorithm, after trimming their
+ * common prefix and suffix.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <string.h>
+#include "utils.h"
+#include "worddiff.h"
+
+/* Past this many edits the whole of both lines is reported as changed */
+#define WORD_DIFF_MAX_EDITS 512
+
+typedef struct {
+    size_t start;
+    size_t end;
+    unsigned int hash;
+    int changed;
+} Token;
+
+static int
+is_word_char(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static int
+is_space_char(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' ||
+           c == '\v' || c == '\f';
+}
+
+static int
+tokenize(Token **out, size_t *n_out, const char *str, size_t len)
+{
+    const unsigned char *s = (const unsigned char *) str;
+    Token *tokens, *token;
+    size_t i = 0, n = 0;
+    unsigned int hash;
+
+    /* There are never more tokens than bytes */
+    tokens = malloc((len ? len : 1) * sizeof(Token));
+    if (tokens == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+
+    while (i < len) {
+        token = &tokens[n++];
+        token->start = i;
+        token->changed = 0;
+
+        i++;
+        if (is_word_char(s[token->start])) {
+            while (i < len && is_word_char(s[i]))
+                i++;
+        } else if (is_space_char(s[token->start])) {
+            while (i < len && is_space_char(s[i]))
+                i++;
+        }
+        token->end = i;
+
+        /* FNV-1a */
+        hash = 2166136261u;
+        for (i = token->start; i < token->end; i++)
+            hash = (hash ^ s[i]) * 16777619u;
+        token->hash = hash;
+    }
+
+    *out = tokens;
+    *n_out = n;
+    return 0;
+}
+
+static int
+token_eq(const Token *a, const char *a_str, const Token *b, const char *b_str)
+{
+    return a->hash == b->hash &&
+           a->end - a->start == b->end - b->start &&
+           memcmp(a_str + a->start, b_str + b->start, a->end - a->start) == 0;
+}
+
+/*
+ * Myers' algorithm over a[0..n) and b[0..m), marking the tokens that are
+ * not part of the shortest edit script.  The furthest reaching x of every
+ * diagonal is kept for each d, the d-th row at offset d * d, so the path
+ * can be walked back.
+ */
+static int
+myers(Token *a, const char *a_str, Py_ssize_t n,
+      Token *b, const char *b_str, Py_ssize_t m)
+{
+    Py_ssize_t max, d, k, x, y, prev_k, *v, *trace, *prev;
+    int found = 0, err = 0;
+
+    max = n + m;
+    if (max > WORD_DIFF_MAX_EDITS)
+        max = WORD_DIFF_MAX_EDITS;
+
+    trace = NULL;
+    MALLOC(v, (2 * max + 3) * sizeof(Py_ssize_t), out);
+    MALLOC(trace, (max + 1) * (max + 1) * sizeof(Py_ssize_t), out);
+
+    /* Indexed by diagonal, k = x - y, from -max - 1 to max + 1 */
+    v += max + 1;
+    v[1] = 0;
+    for (d = 0; d <= max && !found; d++) {
+        for (k = -d; k <= d; k += 2) {
+            if (k == -d || (k != d && v[k - 1] < v[k + 1]))
+                x = v[k + 1];
+            else
+                x = v[k - 1] + 1;
+            y = x - k;
+            while (x < n && y < m && token_eq(&a[x], a_str, &b[y], b_str)) {
+                x++;
+                y++;
+            }
+            v[k] = x;
+            if (x >= n && y >= m) {
+                found = 1;
+                break;
+            }
+        }
+        memcpy(trace + d * d, v - d, (2 * d + 1) * sizeof(Py_ssize_t));
+    }
+    v -= max + 1;
+
+    if (!found) {
+        /* Too many edits to be worth showing, everything changed */
+        for (x = 0; x < n; x++)
+            a[x].changed = 1;
+        for (y = 0; y < m; y++)
+            b[y].changed = 1;
+        goto out;
+    }
+
+    /* Walk the path back from (n, m); each step is a snake of equal
+     * tokens preceded by one insertion or deletion */
+    x = n;
+    y = m;
+    for (d = d - 1; d > 0; d--) {
+        prev = trace + (d - 1) * (d - 1) + (d - 1);
+        k = x - y;
+        if (k == -d || (k != d && prev[k - 1] < prev[k + 1]))
+            prev_k = k + 1;
+        else
+            prev_k = k - 1;
+
+        x = prev[prev_k];
+        y = x - prev_k;
+        if (prev_k == k + 1)
+            b[y].changed = 1;
+        else
+            a[x].changed = 1;
+    }
+
+out:
+    free(v);
+    free(trace);
+    return err;
+}
+
+static int
+collect_spans(WordSpan **out, size_t *n_out, const Token *tokens, size_t n)
+{
+    WordSpan *spans;
+    size_t i, n_spans = 0;
+
+    spans = malloc((n ? n : 1) * sizeof(WordSpan));
+    if (spans == NULL) {
+        giterr_set_oom();
+        return GIT_ERROR;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (!tokens[i].changed)
+            continue;
+        if (n_spans > 0 && spans[n_spans - 1].end == tokens[i].start) {
+            spans[n_spans - 1].end = tokens[i].end;
+            continue;
+        }
+        spans[n_spans].start = tokens[i].start;
+        spans[n_spans].end = tokens[i].end;
+        n_spans++;
+    }
+
+    *out = spans;
+    *n_out = n_spans;
+    return 0;
+}
+
+int
+word_diff(WordSpan **old_spans, size_t *n_old,
+          WordSpan **new_spans, size_t *n_new,
+          const char *old, size_t old_len,
+          const char *new, size_t new_len)
+{
+    Token *a = NULL, *b = NULL;
+    size_t n, m, prefix, suffix;
+    int err;
+
+    *old_spans = NULL;
+    *new_spans = NULL;
+
+    err = tokenize(&a, &n, old, old_len);
+    if (err < 0)
+        goto out;
+    err = tokenize(&b, &m, new, new_len);
+    if (err < 0)
+        goto out;
+
+    /* Most edits touch a few tokens, skip what is common to both ends */
+    for (prefix = 0; prefix < n && prefix < m; prefix++)
+        if (!token_eq(&a[prefix], old, &b[prefix], new))
+            break;
+    for (suffix = 0; suffix < n - prefix && suffix < m - prefix; suffix++)
+        if (!token_eq(&a[n - suffix - 1], old, &b[m - suffix - 1], new))
+            break;
+
+    err = myers(a + prefix, old, n - prefix - suffix,
+                b + prefix, new, m - prefix - suffix);
+    if (err < 0)
+        goto out;
+
+    err = collect_spans(old_spans, n_old, a, n);
+    if (err < 0)
+        goto out;
+    err = collect_spans(new_spans, n_new, b, m);
+    if (err < 0) {
+        free(*old_spans);
+        *old_spans = NULL;
+    }
+
+out:
+    free(a);
+    free(b);
+    return err;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2010-2014 The pygit2 contributors
+ *
+ * This file is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2,
+ * as published by the Free Software Foundation.
+ *
+ * In addition to the permissions in the GNU General Public License,
+ * the authors give you unlimited permission to link the compiled
+ * version of this file into combinations with other programs,
+ * and to distribute those combinations without any restriction
+ * coming from the use of this file.  (The General Public License
+ * restrictions do apply in other respects; for example, they cover
+ * modification of the file, and distribution when not linked into
+ * a combined executable.)
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef INCLUDE_pygit2_worddiff_h
+#define INCLUDE_pygit2_worddiff_h
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <git2.h>
+
+/* A changed byte range of a line, end excluded */
+typedef struct {
+    size_t start;
+    size_t end;
+} WordSpan;
+
+/*
+ * Diffs two lines word by word, and returns the changed byte ranges of
+ * each, merged when adjacent.  The caller frees the spans.  Does not need
+ * the GIL; errors are reported libgit2 style.
+ */
+int word_diff(WordSpan **old_spans, size_t *n_old,
+              WordSpan **new_spans, size_t *n_new,
+              const char *old, size_t old_len,
+              const char *new, size_t new_len);
+
+#endif
@@ -30,7 +30,10 @@
 from __future__ import absolute_import
 from __future__ import unicode_literals
 from os.path import dirname, join
+import io
+import os
 import unittest
+import zlib
 
 import pygit2
 from . import utils
@@ -59,6 +62,51 @@ class BlobTest(utils.RepoTestCase):
         self.assertEqual(len(BLOB_CONTENT), blob.size)
         self.assertEqual(BLOB_CONTENT, blob.read_raw())
 
+    def test_open_reader(self):
+        reader = self.repo.open_reader(BLOB_SHA)
+        self.assertEqual(reader.read(5), b'hello')
+        self.assertEqual(reader.read(0), b'')
+        buf = bytearray(7)
+        self.assertEqual(reader.readinto(buf), 7)
+        self.assertEqual(bytes(buf), b' world\n')
+        self.assertEqual(reader.read(), BLOB_CONTENT[12:])
+        self.assertEqual(reader.read(), b'')
+        reader.close()
+        self.assertTrue(reader.closed)
+        self.assertRaises(ValueError, reader.read)
+
+        reader = self.repo[BLOB_SHA].open_reader(10)
+        chunks = list(reader)
+        self.assertEqual([len(x) for x in chunks], [10, 10, 10, 10])
+        self.assertEqual(b''.join(chunks), BLOB_CONTENT)
+
+        self.assertRaises(ValueError, self.repo.open_reader, BLOB_SHA, 0)
+        self.assertRaises(KeyError, self.repo.open_reader, '1' * 40)
+
+    def test_open_reader_loose(self):
+        # New objects are written loose, and inflated as they are read
+        data = BLOB_NEW_CONTENT * 1000
+        reader = self.repo.open_reader(self.repo.create_blob(data), 4096)
+        self.assertEqual(reader.read(3), data[:3])
+        chunks = list(reader)
+        self.assertEqual(max(len(x) for x in chunks), 4096)
+        self.assertEqual(b''.join(chunks), data[3:])
+        self.assertEqual(reader.read(), b'')
+
+        # Only what is left is allocated
+        reader = self.repo.open_reader(self.repo.create_blob(data))
+        self.assertEqual(reader.read(1 << 40), data)
+
+    def test_open_reader_loose_corrupted(self):
+        oid = self.repo.create_blob(BLOB_NEW_CONTENT)
+        path = join(self.repo.path, 'objects', oid.hex[:2], oid.hex[2:])
+        os.chmod(path, 0o644)
+        with open(path, 'wb') as f:
+            f.write(zlib.compress(b'blob 8\0bar foo\n'))
+
+        reader = self.repo.open_reader(oid)
+        self.assertRaises(pygit2.GitError, reader.read)
+
     def test_create_blob(self):
         blob_oid = self.repo.create_blob(BLOB_NEW_CONTENT)
         blob = self.repo[blob_oid]
@@ -82,6 +130,32 @@ class BlobTest(utils.RepoTestCase):
 
         self.assertRaises(TypeError, set_content)
 
+    def test_create_blob_fromiter(self):
+        chunks = [b'hello world\n', b'', bytearray(b'hola mundo\n'),
+                  b'bonjour le monde\n']
+        blob_oid = self.repo.create_blob_fromiter(iter(chunks))
+        self.assertEqual(blob_oid.hex, BLOB_SHA)
+
+        blob_oid = self.repo.create_blob_fromiter([b'x' * 5000] * 100)
+        self.assertEqual(self.repo[blob_oid].data, b'x' * 500000)
+
+        def failing():
+            yield b'foo'
+            raise ZeroDivisionError
+
+        self.assertRaises(ZeroDivisionError, self.repo.create_blob_fromiter,
+                          failing())
+        self.assertRaises(TypeError, self.repo.create_blob_fromiter, [123])
+
+    def test_create_blob_fromfile(self):
+        blob_oid = self.repo.create_blob_fromfile(io.BytesIO(BLOB_CONTENT))
+        self.assertEqual(blob_oid.hex, BLOB_SHA)
+
+        content = b'0123456789' * 20000
+        blob_oid = self.repo.create_blob_fromfile(io.BytesIO(content))
+        self.assertEqual(blob_oid.hex, utils.gen_blob_sha1(content))
+        self.assertEqual(self.repo[blob_oid].data, content)
+
     def test_create_blob_fromworkdir(self):
 
         blob_oid = self.repo.create_blob_fromworkdir("bye.txt")
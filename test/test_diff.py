@@ -29,6 +29,8 @@
 
 from __future__ import absolute_import
 from __future__ import unicode_literals
+import io
+import os
 import unittest
 import pygit2
 from pygit2 import GIT_DIFF_INCLUDE_UNMODIFIED
@@ -137,6 +139,21 @@ class DiffDirtyTest(utils.DirtyRepoTestCase):
         files = [patch.delta.new_file.path for patch in diff]
         self.assertEqual(DIFF_INDEX_TO_WORK_EXPECTED, files)
 
+    def test_patches_diff_drivers(self):
+        # The drivers are loaded lazily and shared by the deltas
+        path = os.path.join(self.repo.workdir, '.gitattributes')
+        with open(path, 'w') as f:
+            f.write('* diff=python\nsubdir/* diff=cpp\nmodified_file diff=foo\n')
+
+        diff = self.repo.diff('HEAD')
+        expected = [[h.header for h in p.hunks] for p in diff]
+        for threads in (1, 4):
+            patches = diff.patches(threads=threads)
+            self.assertEqual([p.delta.new_file.path for p in patches],
+                             DIFF_HEAD_TO_WORKDIR_EXPECTED)
+            self.assertEqual([[h.header for h in p.hunks] for p in patches],
+                             expected)
+
 
 class DiffTest(utils.BareRepoTestCase):
 
@@ -263,6 +280,44 @@ class DiffTest(utils.BareRepoTestCase):
         self.assertEqual(diff.patch, PATCH)
         self.assertEqual(len(diff), len([patch for patch in diff]))
 
+    def test_iter_patch_chunks(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+
+        chunks = list(diff.iter_patch_chunks(chunk_size=40))
+        self.assertTrue(len(chunks) > 1)
+        self.assertTrue(all(x.endswith('\n') for x in chunks))
+        self.assertEqual(''.join(chunks), PATCH)
+
+        chunks = list(diff.iter_patch_chunks(as_bytes=True))
+        self.assertEqual(chunks, [PATCH.encode('utf-8')])
+
+    def test_write_patch(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+
+        out = io.StringIO()
+        diff.write_patch(out, chunk_size=1)
+        self.assertEqual(out.getvalue(), PATCH)
+
+        out = io.BytesIO()
+        diff.write_patch(out, as_bytes=True)
+        self.assertEqual(out.getvalue(), PATCH.encode('utf-8'))
+
+    def test_patches(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+
+        for threads in (0, 1, 4):
+            patches = diff.patches(threads=threads)
+            self.assertEqual([p.delta.new_file.path for p in patches],
+                             [p.delta.new_file.path for p in diff])
+            self.assertEqual([p.line_stats for p in patches],
+                             [p.line_stats for p in diff])
+
     def test_diff_ids(self):
         commit_a = self.repo[COMMIT_SHA1_1]
         commit_b = self.repo[COMMIT_SHA1_2]
@@ -280,6 +335,28 @@ class DiffTest(utils.BareRepoTestCase):
         lines = ('{0} {1}'.format(x.origin, x.content) for x in hunk.lines)
         self.assertEqual(HUNK_EXPECTED, ''.join(lines))
 
+    def test_lazy_hunks(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+        patch = commit_a.tree.diff_to_tree(commit_b.tree)[0]
+        self.assertEqual(len(patch.hunks), 1)
+        lines = patch.hunks[-1].lines
+        self.assertEqual(len(lines), 2)
+        self.assertEqual(lines[-1].origin, '+')
+        self.assertEqual([x.origin for x in lines[:1]], ['-'])
+        self.assertRaises(IndexError, lambda: lines[2])
+        self.assertRaises(IndexError, lambda: patch.hunks[1])
+
+    def test_word_diff(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+        hunk = diff[0].hunks[0]
+        self.assertEqual(hunk.word_diff(), [(0, 1, [(10, 12)], [])])
+        self.assertEqual(hunk.lines[0].content[10:12], ' 2')
+        # Deleted lines with nothing added after them are not paired
+        self.assertEqual(diff[1].hunks[0].word_diff(), [])
+
     def test_find_similar(self):
         commit_a = self.repo[COMMIT_SHA1_6]
         commit_b = self.repo[COMMIT_SHA1_7]
@@ -294,6 +371,17 @@ class DiffTest(utils.BareRepoTestCase):
         self.assertAny(lambda x: x.delta.status == GIT_DELTA_RENAMED, diff)
         self.assertAny(lambda x: x.delta.status_char() == 'R', diff)
 
+    def test_find_similar_exact(self):
+        commit_a = self.repo[COMMIT_SHA1_6]
+        commit_b = self.repo[COMMIT_SHA1_7]
+
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+        diff.find_similar(pygit2.GIT_DIFF_FIND_RENAMES |
+                          pygit2.GIT_DIFF_FIND_EXACT_MATCH_ONLY,
+                          rename_limit=10)
+        self.assertEqual([x.delta.status for x in diff], [GIT_DELTA_RENAMED])
+        self.assertRaises(ValueError, diff.find_similar, rename_limit=-1)
+
     def test_diff_stats(self):
         commit_a = self.repo[COMMIT_SHA1_1]
         commit_b = self.repo[COMMIT_SHA1_2]
@@ -308,5 +396,13 @@ class DiffTest(utils.BareRepoTestCase):
                                  width=80)
         self.assertEqual(STATS_EXPECTED, formatted)
 
+    def test_numstat(self):
+        commit_a = self.repo[COMMIT_SHA1_1]
+        commit_b = self.repo[COMMIT_SHA1_2]
+
+        diff = commit_a.tree.diff_to_tree(commit_b.tree)
+        self.assertEqual(diff.numstat(),
+                         [('a', 1, 1, False), ('c/d', 0, 1, False)])
+
 if __name__ == '__main__':
     unittest.main()
@@ -32,6 +32,7 @@ from __future__ import unicode_literals
 import os
 import unittest
 import tempfile
+import threading
 
 import pygit2
 from pygit2 import Repository, Index
@@ -177,6 +178,35 @@ class IndexTest(utils.RepoTestCase):
         index.remove('hello.txt')
         self.assertFalse('hello.txt' in index)
 
+    def test_add_threaded(self):
+        index = self.repo.index
+        before = [(entry.path, entry.id) for entry in index]
+        hello_id = index['hello.txt'].id
+        paths = ['new_%d.txt' % i for i in range(20)]
+        for path in paths:
+            with open(os.path.join(self.repo.workdir, path), 'w') as f:
+                f.write(path)
+
+        def worker():
+            for path in paths:
+                index.add(path)
+                index.add('bye.txt')
+                index.remove('bye.txt')
+
+        thread = threading.Thread(target=worker)
+        thread.start()
+        while thread.is_alive():
+            # Lookups race with the entries being replaced
+            self.assertEqual(index['hello.txt'].id, hello_id)
+            self.assertTrue('.gitignore' in index)
+            self.assertTrue(len(index) >= len(before))
+        thread.join()
+
+        added = [(path, self.repo.create_blob(path)) for path in paths]
+        self.assertEqual([(entry.path, entry.id) for entry in index],
+                         sorted(before + added))
+        self.assertFalse('bye.txt' in index)
+
     def test_change_attributes(self):
         index = self.repo.index
         entry = index['hello.txt']
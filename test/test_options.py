@@ -33,6 +33,11 @@ import unittest
 import pygit2
 from pygit2 import GIT_OPT_GET_MWINDOW_SIZE, GIT_OPT_SET_MWINDOW_SIZE
 from pygit2 import GIT_OPT_GET_SEARCH_PATH, GIT_OPT_SET_SEARCH_PATH
+from pygit2 import GIT_OPT_GET_MWINDOW_MAPPED_LIMIT
+from pygit2 import GIT_OPT_SET_MWINDOW_MAPPED_LIMIT
+from pygit2 import GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OPT_SET_CACHE_MAX_SIZE
+from pygit2 import GIT_OPT_ENABLE_CACHING, GIT_OPT_GET_CACHED_MEMORY
+from pygit2 import GIT_OBJ_BLOB
 from pygit2 import GIT_CONFIG_LEVEL_SYSTEM, GIT_CONFIG_LEVEL_XDG, GIT_CONFIG_LEVEL_GLOBAL
 from pygit2 import option
 from . import utils
@@ -50,6 +55,59 @@ class OptionsTest(utils.NoRepoTestCase):
 
         self.assertEqual(new_size, pygit2.settings.mwindow_size)
 
+    def test_mwindow_mapped_limit(self):
+        new_limit = 200 * 1024 * 1024
+        option(GIT_OPT_SET_MWINDOW_MAPPED_LIMIT, new_limit)
+        self.assertEqual(new_limit, option(GIT_OPT_GET_MWINDOW_MAPPED_LIMIT))
+
+    def test_mwindow_mapped_limit_proxy(self):
+        new_limit = 300 * 1024 * 1024
+        pygit2.settings.mwindow_mapped_limit = new_limit
+
+        self.assertEqual(new_limit, pygit2.settings.mwindow_mapped_limit)
+
+    def test_cache_max_size(self):
+        current, allowed = option(GIT_OPT_GET_CACHED_MEMORY)
+        try:
+            option(GIT_OPT_SET_CACHE_MAX_SIZE, 64 * 1024 * 1024)
+            self.assertEqual(option(GIT_OPT_GET_CACHED_MEMORY)[1],
+                             64 * 1024 * 1024)
+        finally:
+            option(GIT_OPT_SET_CACHE_MAX_SIZE, allowed)
+
+    def test_cache_max_size_proxy(self):
+        current, allowed = pygit2.settings.cached_memory
+        self.assertTrue(0 <= current <= allowed)
+        try:
+            pygit2.settings.cache_max_size(32 * 1024 * 1024)
+            self.assertEqual(pygit2.settings.cached_memory[1],
+                             32 * 1024 * 1024)
+        finally:
+            pygit2.settings.cache_max_size(allowed)
+
+    def test_cache_object_limit(self):
+        blob_id = 'af431f20fc541ed6d5afede3e2dc7160f6f01f16'
+        with utils.TemporaryRepository(('git', 'testrepo.git')) as path:
+            repo = pygit2.Repository(path)
+            try:
+                # Blobs over the limit are not kept in libgit2's cache
+                pygit2.settings.cache_object_limit(GIT_OBJ_BLOB, 0)
+                used = option(GIT_OPT_GET_CACHED_MEMORY)[0]
+                repo[blob_id]
+                self.assertTrue(option(GIT_OPT_GET_CACHED_MEMORY)[0] <= used)
+
+                option(GIT_OPT_SET_CACHE_OBJECT_LIMIT, GIT_OBJ_BLOB, 1024)
+                used = option(GIT_OPT_GET_CACHED_MEMORY)[0]
+                repo[blob_id]
+                self.assertTrue(option(GIT_OPT_GET_CACHED_MEMORY)[0] > used)
+            finally:
+                pygit2.settings.cache_object_limit(GIT_OBJ_BLOB, 0)
+
+    def test_enable_caching(self):
+        option(GIT_OPT_ENABLE_CACHING, False)
+        pygit2.settings.enable_caching()
+        self.assertRaises(TypeError, option, GIT_OPT_SET_CACHE_MAX_SIZE, 'a')
+
     def test_search_path(self):
         paths = [(GIT_CONFIG_LEVEL_GLOBAL, '/tmp/global'),
                  (GIT_CONFIG_LEVEL_XDG,    '/tmp/xdg'),
@@ -35,6 +35,8 @@ from __future__ import unicode_literals
 import binascii
 import unittest
 import tempfile
+import threading
+import weakref
 import os
 from os.path import join, realpath
 import sys
@@ -99,6 +101,100 @@ class RepositoryTest(utils.BareRepoTestCase):
         a3 = self.repo.read(a_hex_prefix)
         self.assertEqual((GIT_OBJ_BLOB, b'a contents\n'), a3)
 
+    def test_read_buffer(self):
+        self.assertRaises(TypeError, self.repo.read_buffer, 123)
+        self.assertRaisesWithArg(KeyError, '1' * 40, self.repo.read_buffer,
+                                 '1' * 40)
+
+        obj = self.repo.read_buffer(BLOB_HEX[:4])
+        self.assertEqual(obj.id, BLOB_OID)
+        self.assertEqual(obj.type, GIT_OBJ_BLOB)
+        self.assertEqual(obj.size, 11)
+        self.assertEqual(bytes(memoryview(obj)), b'a contents\n')
+
+        commit = self.repo[HEAD_SHA]
+        raw = commit.read_buffer()
+        self.assertEqual(raw.type, GIT_OBJ_COMMIT)
+        self.assertEqual(memoryview(raw).tobytes(), commit.read_raw())
+
+    def test_read_many(self):
+        a2 = '7f129fd57e31e935c6d60a0c794efe4e6927664b'
+        objs = self.repo.read_many([BLOB_OID, a2, BLOB_HEX[:4]])
+        self.assertEqual(objs, [(GIT_OBJ_BLOB, b'a contents\n'),
+                                (GIT_OBJ_BLOB, b'a contents 2\n'),
+                                (GIT_OBJ_BLOB, b'a contents\n')])
+        self.assertEqual(self.repo.read_many([]), [])
+        self.assertRaises(TypeError, self.repo.read_many, [123])
+        self.assertRaisesWithArg(KeyError, '1' * 40, self.repo.read_many,
+                                 [BLOB_HEX, '1' * 40])
+
+    def test_lookup_many(self):
+        objs = self.repo.lookup_many([HEAD_SHA, BLOB_OID, '1' * 40])
+        self.assertEqual(len(objs), 3)
+        self.assertEqual(objs[0].type, GIT_OBJ_COMMIT)
+        self.assertEqual(objs[0].hex, HEAD_SHA)
+        self.assertEqual(objs[1].read_raw(), b'a contents\n')
+        self.assertTrue(objs[2] is None)
+
+    def test_object_cache(self):
+        self.assertEqual(self.repo.object_cache_size, 0)
+        self.assertFalse(self.repo[HEAD_SHA] is self.repo[HEAD_SHA])
+
+        self.repo.object_cache_size = 2
+        commit = self.repo[HEAD_SHA]
+        self.assertTrue(self.repo[HEAD_SHA] is commit)
+        self.assertTrue(commit.parents[0] is self.repo[PARENT_SHA])
+        self.assertEqual(self.repo.object_cache_stats,
+                         {'hits': 2, 'misses': 2, 'size': 2})
+
+        # The least recently used object is dropped, but it is still found
+        # while it is alive
+        self.repo[BLOB_HEX]
+        self.assertTrue(self.repo[PARENT_SHA] is commit.parents[0])
+        self.assertEqual(self.repo.object_cache_stats['size'], 2)
+        self.assertTrue(self.repo[HEAD_SHA] is commit)
+
+        # The cache keeps the most recent objects alive
+        ref = weakref.ref(self.repo[BLOB_HEX])
+        self.assertTrue(ref() is not None)
+        self.assertTrue(self.repo[BLOB_HEX] is ref())
+
+        # Past the limit, objects are reused while referred to elsewhere
+        blob = ref()
+        self.repo[HEAD_SHA]
+        self.repo[PARENT_SHA]
+        self.assertEqual(self.repo.object_cache_stats['size'], 2)
+        self.assertTrue(self.repo[BLOB_HEX] is blob)
+        self.repo[HEAD_SHA]
+        self.repo[PARENT_SHA]
+        del blob
+        self.assertTrue(ref() is None)
+
+        self.repo.object_cache_size = 0
+        self.assertEqual(self.repo.object_cache_stats['size'], 0)
+        self.assertRaises(ValueError, setattr, self.repo,
+                          'object_cache_size', -1)
+
+    def test_read_threaded(self):
+        results = []
+
+        def worker():
+            for i in range(50):
+                results.append(self.repo.read(BLOB_HEX))
+            results.append([c.hex for c in self.repo.walk(HEAD_SHA)])
+
+        threads = [threading.Thread(target=worker) for i in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        self.assertEqual(len(results), 4 * 51)
+        blobs = [x for x in results if isinstance(x, tuple)]
+        walks = [x for x in results if isinstance(x, list)]
+        self.assertEqual(blobs, [(GIT_OBJ_BLOB, b'a contents\n')] * 200)
+        self.assertTrue(all(w == walks[0] and w[0] == HEAD_SHA for w in walks))
+
     def test_write(self):
         data = b"hello world"
         # invalid object type
@@ -107,6 +203,36 @@ class RepositoryTest(utils.BareRepoTestCase):
         oid = self.repo.write(GIT_OBJ_BLOB, data)
         self.assertEqual(type(oid), Oid)
 
+    def test_pack_writer(self):
+        pack_dir = join(self.repo.path, 'objects', 'pack')
+        packs = set(os.listdir(pack_dir))
+
+        writer = self.repo.PackWriter()
+        oids = [writer.write(GIT_OBJ_BLOB, ('blob %d\n' % i).encode())
+                for i in range(100)]
+        # Objects already in the repository or the pack are skipped
+        self.assertEqual(writer.write(GIT_OBJ_BLOB, b'a contents\n'), BLOB_OID)
+        self.assertEqual(writer.write(GIT_OBJ_BLOB, b'blob 0\n'), oids[0])
+        self.assertRaises(ValueError, writer.write, GIT_OBJ_ANY, b'')
+        self.assertEqual(len(writer), 100)
+        self.assertFalse(oids[0] in self.repo)
+
+        self.assertEqual(writer.commit(), 100)
+        self.assertEqual(len(writer), 0)
+        self.assertEqual(self.repo[oids[42]].data, b'blob 42\n')
+        new_packs = set(os.listdir(pack_dir)) - packs
+        self.assertEqual(len(new_packs), 2)
+        self.assertEqual(set(os.path.splitext(x)[1] for x in new_packs),
+                         set(['.pack', '.idx']))
+
+    def test_pack_writer_rollback(self):
+        writer = self.repo.PackWriter()
+        oid = writer.write(GIT_OBJ_BLOB, b'discarded\n')
+        writer.rollback()
+        self.assertEqual(len(writer), 0)
+        self.assertEqual(writer.commit(), 0)
+        self.assertFalse(oid in self.repo)
+
     def test_contains(self):
         self.assertRaises(TypeError, lambda: 123 in self.repo)
         self.assertTrue(BLOB_OID in self.repo)
@@ -120,6 +246,26 @@ class RepositoryTest(utils.BareRepoTestCase):
         oid = Oid(hex=BLOB_HEX)
         self.assertTrue(oid in l)
 
+    def test_iter_objects(self):
+        oids = list(self.repo.iter_objects())
+        self.assertEqual(len(oids), 33)
+        self.assertEqual(sorted(oids), sorted(self.repo))
+
+        commits = list(self.repo.iter_objects(GIT_OBJ_COMMIT))
+        self.assertEqual(len(commits), 10)
+        self.assertTrue(Oid(hex=HEAD_SHA) in commits)
+        for oid in commits:
+            self.assertEqual(self.repo[oid].type, GIT_OBJ_COMMIT)
+
+        self.assertRaises(ValueError, self.repo.iter_objects, 42)
+
+    def test_iter_objects_partial(self):
+        # Dropping an iterator half-way must stop the background walk
+        for i in range(10):
+            it = iter(self.repo)
+            self.assertEqual(type(next(it)), Oid)
+            del it
+
     def test_lookup_blob(self):
         self.assertRaises(TypeError, lambda: self.repo[123])
         self.assertEqual(self.repo[BLOB_OID].hex, BLOB_HEX)
@@ -344,6 +490,113 @@ class RepositoryTest_II(utils.RepoTestCase):
         self.assertEqual(2, ahead)
         self.assertEqual(1, behind)
 
+    def test_commit_graph(self):
+        self.assertFalse(self.repo.load_commit_graph())
+        count = self.repo.write_commit_graph()
+        self.assertEqual(count, len(list(self.repo.walk(
+            self.repo.head.target))) + 1)
+        self.assertTrue(os.path.exists(os.path.join(
+            self.repo.path, 'objects', 'info', 'pygit2-commit-graph')))
+
+        # Same answers as without the graph
+        self.test_merge_base()
+        self.test_ahead_behind()
+        self.assertEqual(
+            self.repo.merge_base(self.repo.head.target,
+                                 '5ebeeebb320790caf276b9fc8b24546d63316533').hex,
+            '5ebeeebb320790caf276b9fc8b24546d63316533')
+        self.assertEqual(self.repo.ahead_behind(self.repo.head.target,
+                                                self.repo.head.target),
+                         (0, 0))
+
+        # A new repository object loads it on first use
+        repo = pygit2.Repository(self.repo.path)
+        self.assertEqual(
+            repo.merge_base('5ebeeebb320790caf276b9fc8b24546d63316533',
+                            '4ec4389a8068641da2d6578db0419484972284c8').hex,
+            'acecd5ea2924a4b900e7e149496e1f4b57976e51')
+        self.assertTrue(repo.load_commit_graph())
+
+    def create_criss_cross(self, name, x1_time, y1_time):
+        # x2 merges y1 into x1, and y2 merges x1 into y1, so x2 and y2 have
+        # two merge bases, x1 and y1
+        tree = self.repo.head.peel().tree.id
+        base = self.repo.head.target
+
+        def commit(suffix, parents, time):
+            sig = pygit2.Signature('A', 'a@example.com', time, 0)
+            return self.repo.create_commit('refs/heads/%s-%s' % (name, suffix),
+                                           sig, sig, suffix, tree, parents)
+
+        x1 = commit('x1', [base], x1_time)
+        y1 = commit('y1', [base], y1_time)
+        x2 = commit('x2', [x1, y1], 1400000100)
+        y2 = commit('y2', [y1, x1], 1400000200)
+        return x2, y2
+
+    def test_merge_base_criss_cross(self):
+        pairs = []
+        # Either merge base the newer one
+        for name, times in [('a', (1400000001, 1400000002)),
+                            ('b', (1400000002, 1400000001))]:
+            x2, y2 = self.create_criss_cross(name, *times)
+            pairs += [(x2, y2), (y2, x2)]
+        expected = [self.repo.merge_base(a, b) for a, b in pairs]
+
+        # The graph leaves the choice among merge bases to libgit2
+        self.repo.write_commit_graph()
+        self.assertEqual([self.repo.merge_base(a, b) for a, b in pairs],
+                         expected)
+        x2, y2 = pairs[0]
+        self.assertEqual(self.repo.merge_base_batch([x2, x2], y2),
+                         [expected[0], expected[0]])
+
+    def test_is_ancestor_many(self):
+        ids = ['acecd5ea2924a4b900e7e149496e1f4b57976e51',
+               '5ebeeebb320790caf276b9fc8b24546d63316533',
+               '4ec4389a8068641da2d6578db0419484972284c8']
+        expected = [True, True, False]
+        head = self.repo.head.target
+
+        self.assertEqual(self.repo.is_ancestor_many(ids, ids[1]), expected)
+        self.assertEqual(self.repo.reachable_count(head), 5)
+
+        self.repo.write_commit_graph()
+        self.assertEqual(self.repo.is_ancestor_many(ids, ids[1]), expected)
+        self.assertEqual(self.repo.is_ancestor_many([head], ids[1]), [False])
+        self.assertEqual(self.repo.reachable_count(ids[1]), 2)
+        self.assertEqual(self.repo.reachable_count(head), 5)
+
+    def test_batch(self):
+        tips = ['5ebeeebb320790caf276b9fc8b24546d63316533',
+                '4ec4389a8068641da2d6578db0419484972284c8',
+                '5ebeeebb320790caf276b9fc8b24546d63316533']
+        upstream = tips[1]
+
+        for i in range(2):
+            self.assertEqual(self.repo.ahead_behind_batch(tips, upstream),
+                             [(1, 2), (0, 0), (1, 2)])
+            bases = self.repo.merge_base_batch(tips, upstream)
+            self.assertEqual([x.hex for x in bases],
+                             ['acecd5ea2924a4b900e7e149496e1f4b57976e51',
+                              upstream,
+                              'acecd5ea2924a4b900e7e149496e1f4b57976e51'])
+            # Same again, from the commit-graph
+            self.repo.write_commit_graph()
+
+        # Commits newer than the graph, interleaved with commits in it
+        sig = pygit2.Signature('A', 'a@example.com')
+        tree = self.repo.head.peel().tree.id
+        orphan = self.repo.create_commit(None, sig, sig, 'orphan', tree, [])
+        child = self.repo.create_commit(None, sig, sig, 'child', tree,
+                                        [tips[0]])
+        bases = self.repo.merge_base_batch([orphan, tips[0], child, tips[1]],
+                                           upstream)
+        self.assertEqual([x and x.hex for x in bases],
+                         [None, 'acecd5ea2924a4b900e7e149496e1f4b57976e51',
+                          'acecd5ea2924a4b900e7e149496e1f4b57976e51',
+                          upstream])
+
     def test_reset_hard(self):
         ref = "5ebeeebb320790caf276b9fc8b24546d63316533"
         with open(os.path.join(self.repo.workdir, "hello.txt")) as f:
@@ -29,9 +29,11 @@
 
 from __future__ import absolute_import
 from __future__ import unicode_literals
+import binascii
 import unittest
 
 from pygit2 import GIT_SORT_NONE, GIT_SORT_TIME, GIT_SORT_REVERSE
+from pygit2 import Oid
 from . import utils
 
 
@@ -115,5 +117,90 @@ class WalkerTest(utils.RepoTestCase):
 
         self.assertEqual(list1, list2)
 
+    def test_walk_ids(self):
+        walker = self.repo.walk_ids(log[0], GIT_SORT_TIME)
+        ids = list(walker)
+        self.assertTrue(all(isinstance(x, Oid) for x in ids))
+        self.assertEqual([x.hex for x in ids], log)
+
+    def test_next_ids(self):
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        ids = walker.next_ids(3)
+        self.assertEqual(len(ids), 60)
+        self.assertEqual(ids[20:40], Oid(hex=log[1]).raw)
+        self.assertEqual(len(walker.next_ids(3)), 40)
+        self.assertEqual(walker.next_ids(3), b'')
+
+    def test_to_arrays(self):
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        arrays = walker.to_arrays()
+        ids = arrays['id']
+        self.assertEqual(len(ids), 20 * len(log))
+        self.assertEqual([binascii.hexlify(ids[i:i + 20]).decode('ascii')
+                          for i in range(0, len(ids), 20)], log)
+
+        commits = [self.repo[x] for x in log]
+        self.assertEqual(list(arrays['commit_time']),
+                         [c.commit_time for c in commits])
+        self.assertEqual(list(arrays['commit_time_offset']),
+                         [c.commit_time_offset for c in commits])
+        self.assertEqual(list(arrays['parent_count']),
+                         [len(c.parent_ids) for c in commits])
+        self.assertEqual(arrays['tree_id'][:20], commits[0].tree_id.raw)
+
+        data = arrays['author_name']
+        offsets = arrays['author_name_offsets']
+        self.assertEqual(len(offsets), len(log) + 1)
+        self.assertEqual(
+            [data[offsets[i]:offsets[i + 1]].decode('utf-8')
+             for i in range(len(log))],
+            [c.author.name for c in commits])
+
+        # The walker is consumed
+        self.assertEqual(len(walker.to_arrays()['id']), 0)
+
+    def test_to_arrays_limit(self):
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        self.assertEqual(len(walker.to_arrays(2)['id']), 40)
+        self.assertEqual([x.hex for x in walker], log[2:])
+
+    def test_filter_paths(self):
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        walker.filter_paths(['hello.txt'])
+        # The merge took hello.txt from its second parent
+        self.assertEqual([x.hex for x in walker], log[2:])
+
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        walker.filter_paths(['.gitignore', 'hello.txt'])
+        self.assertEqual([x.hex for x in walker], log)
+
+        walker = self.repo.walk_ids(log[0], GIT_SORT_TIME)
+        walker.filter_paths(['/.gitignore/'])
+        self.assertEqual([x.hex for x in walker], log[1:2])
+
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        walker.filter_paths(['hello.txt/nope'])
+        self.assertEqual(list(walker), [])
+
+        walker = self.repo.walk(log[0], GIT_SORT_TIME)
+        walker.filter_paths(['hello.txt'])
+        walker.filter_paths([])
+        self.assertEqual(len(list(walker)), len(log))
+
+        self.assertRaises(ValueError, walker.filter_paths, ['/'])
+
+    def test_walk_parallel(self):
+        ids = []
+        batches = self.repo.walk_parallel([log[1], log[0]], threads=2,
+                                          chunk=1)
+        for arrays in batches:
+            self.assertEqual(len(arrays['author_name_offsets']),
+                             len(arrays['id']) // 20 + 1)
+            ids.extend(binascii.hexlify(arrays['id'][i:i + 20]).decode()
+                       for i in range(0, len(arrays['id']), 20))
+        self.assertEqual(sorted(ids), sorted(log))
+
+        self.assertRaises(ValueError, self.repo.walk_parallel, log, chunk=0)
+
 if __name__ == '__main__':
     unittest.main()
@@ -32,7 +32,7 @@ from __future__ import unicode_literals
 import operator
 import unittest
 
-from pygit2 import TreeEntry
+from pygit2 import TreeEntry, GIT_TREEWALK_POST
 from . import utils
 
 
@@ -133,6 +133,49 @@ class TreeTest(utils.BareRepoTestCase):
         for tree_entry in tree:
             self.assertEqual(tree_entry, tree[tree_entry.name])
 
+    def test_entry_outlives_tree(self):
+        entries = list(self.repo[TREE_SHA])
+        entry = self.repo[TREE_SHA]['b']
+        self.assertEqual([x.name for x in entries], ['a', 'b', 'c'])
+        self.assertEqual(entry.hex, '85f120ee4dac60d0719fd51731e4199aa5a37df6')
+
+    def test_entries_as_tuples(self):
+        tree = self.repo[TREE_SHA]
+        self.assertEqual(tree.entries_as_tuples(),
+                         [(x.name, x.id, x.filemode) for x in tree])
+        self.assertEqual(tree.entries_as_tuples()[2][2], 0o0040000)
+
+    def test_walk(self):
+        tree = self.repo[TREE_SHA]
+        entries = [x for batch in tree.walk() for x in batch]
+        self.assertEqual([x[0] for x in entries], ['a', 'b', 'c', 'c/d'])
+        self.assertEqual(entries[2][1].hex, SUBTREE_SHA)
+        self.assertEqual(entries[2][2], 0o0040000)
+        self.assertEqual(entries[3][1].hex,
+                         '297efb891a47de80be0cfe9c639e4b8c9b450989')
+
+        entries = [x[0] for batch in tree.walk(GIT_TREEWALK_POST)
+                   for x in batch]
+        self.assertEqual(entries, ['a', 'b', 'c/d', 'c'])
+
+        self.assertEqual([len(x) for x in tree.walk(batch=3)], [3, 1])
+        self.assertEqual(list(tree.walk(paths=['c/*'])),
+                         [[('c/d', tree['c/d'].id, 0o0100644)]])
+        self.assertEqual(list(tree.walk(paths=['x/*'])), [])
+        self.assertRaises(ValueError, tree.walk, 2)
+
+    def test_changed_paths(self):
+        tree_a = self.repo['18e2d2e9db075f9eb43bcb2daa65a2867d29a15e']
+        tree_b = self.repo['2ad1d3456c5c4a1c9e40aeeddb9cd20b409623c8']
+        self.assertEqual(tree_a.changed_paths(tree_b),
+                         [('a', tree_a['a'].id, tree_b['a'].id)])
+        self.assertEqual(tree_a.changed_paths(tree_a), [])
+
+        # Against the empty tree
+        changes = tree_a.changed_paths()
+        self.assertEqual([x[0] for x in changes], ['a', 'b', 'c/d'])
+        self.assertEqual(changes[2], ('c/d', tree_a['c/d'].id, None))
+
     def test_deep_contains(self):
         tree = self.repo[TREE_SHA]
         self.assertTrue('a' in tree)